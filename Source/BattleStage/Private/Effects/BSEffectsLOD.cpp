@@ -0,0 +1,151 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BattleStage.h"
+#include "BSEffectsLOD.h"
+
+DEFINE_STAT(STAT_BSTracersPlayed);
+DEFINE_STAT(STAT_BSTracersCulled);
+DEFINE_STAT(STAT_BSImpactsPlayed);
+DEFINE_STAT(STAT_BSImpactsCulledDistance);
+DEFINE_STAT(STAT_BSImpactsCulledBudget);
+DEFINE_STAT(STAT_BSImpactSoundsPlayed);
+DEFINE_STAT(STAT_BSImpactSoundsCulled);
+
+static TAutoConsoleVariable<float> CVarTracerDistance(
+	TEXT("bs.TracerDistance"),
+	6000.f,
+	TEXT("Tracers that don't pass within this distance of the local view are not spawned. 0 disables tracers."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<float> CVarImpactEffectDistance(
+	TEXT("bs.ImpactEffectDistance"),
+	5000.f,
+	TEXT("Impacts further than this from the local view don't spawn particles or decals."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<int32> CVarImpactEffectBudget(
+	TEXT("bs.ImpactEffectBudget"),
+	12,
+	TEXT("Max impact effects spawned per frame. Impacts over budget only play their sound."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<float> CVarImpactSoundRangeScale(
+	TEXT("bs.ImpactSoundRangeScale"),
+	1.f,
+	TEXT("Scales the attenuation range impact sounds are culled outside of."),
+	ECVF_Scalability);
+
+bool FBSEffectsLOD::GetViewLocation(const UWorld* World, FVector& OutViewLocation)
+{
+	const APlayerController* const PlayerController = World ? World->GetFirstPlayerController() : nullptr;
+	if (!PlayerController)
+	{
+		return false;
+	}
+
+	FRotator ViewRotation;
+	PlayerController->GetPlayerViewPoint(OutViewLocation, ViewRotation);
+
+	return true;
+}
+
+bool FBSEffectsLOD::IsTracerRelevant(const FVector& ViewLocation, const FVector& Start, const FVector& End)
+{
+	const float MaxDistance = CVarTracerDistance.GetValueOnGameThread();
+	return MaxDistance > 0.f && FMath::PointDistToSegmentSquared(ViewLocation, Start, End) <= FMath::Square(MaxDistance);
+}
+
+bool FBSEffectsLOD::IsImpactRelevant(const FVector& ViewLocation, const FVector& ImpactLocation)
+{
+	const float MaxDistance = CVarImpactEffectDistance.GetValueOnGameThread();
+	return FVector::DistSquared(ViewLocation, ImpactLocation) <= FMath::Square(MaxDistance);
+}
+
+bool FBSEffectsLOD::ConsumeImpactBudget()
+{
+	static FBSEffectBudget Budget;
+	return Budget.Consume(GFrameCounter, CVarImpactEffectBudget.GetValueOnGameThread());
+}
+
+bool FBSEffectsLOD::IsSoundAudible(const FVector& ViewLocation, const FVector& SoundLocation, const float MaxAudibleDistance)
+{
+	const float Range = MaxAudibleDistance * CVarImpactSoundRangeScale.GetValueOnGameThread();
+	return FVector::DistSquared(ViewLocation, SoundLocation) <= FMath::Square(Range);
+}
+
+bool FBSEffectsLOD::IsSoundAudible(const FVector& ViewLocation, const FVector& SoundLocation, USoundBase* Sound)
+{
+	// Unattenuated sounds report WORLD_MAX and are always audible
+	return Sound && IsSoundAudible(ViewLocation, SoundLocation, Sound->GetMaxAudibleDistance());
+}
+
+//-----------------------------------------------------------------
+// Benchmark
+//-----------------------------------------------------------------
+
+/**
+* Runs the LOD policy over synthetic gunfire around a viewer at the origin and logs how much of
+* it would be spawned. Doesn't need a viewport or a local player, so it runs on headless clients.
+*
+* Usage: bs.BenchEffectsLOD [Shots=10000] [ShotsPerFrame=64] [Radius=20000] [SoundRange=4000]
+*/
+static void BenchEffectsLOD(const TArray<FString>& Args)
+{
+	const int32 Shots = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 10000;
+	const int32 ShotsPerFrame = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : 64;
+	const float Radius = Args.Num() > 2 ? FCString::Atof(*Args[2]) : 20000.f;
+	const float SoundRange = Args.Num() > 3 ? FCString::Atof(*Args[3]) : 4000.f;
+
+	// Fixed seed so runs are comparable between changes to the cvars
+	FRandomStream RandomStream(0x5EED);
+
+	const FVector ViewLocation = FVector::ZeroVector;
+	const int32 Budget = CVarImpactEffectBudget.GetValueOnGameThread();
+
+	FBSEffectBudget FrameBudget;
+
+	int32 TracersPlayed = 0;
+	int32 ImpactsPlayed = 0;
+	int32 ImpactsCulledDistance = 0;
+	int32 ImpactsCulledBudget = 0;
+	int32 SoundsPlayed = 0;
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	for (int32 i = 0; i < Shots; ++i)
+	{
+		const FVector Start = RandomStream.GetUnitVector() * RandomStream.FRandRange(0.f, Radius);
+		const FVector End = Start + RandomStream.GetUnitVector() * RandomStream.FRandRange(500.f, 5000.f);
+
+		TracersPlayed += FBSEffectsLOD::IsTracerRelevant(ViewLocation, Start, End) ? 1 : 0;
+
+		if (!FBSEffectsLOD::IsImpactRelevant(ViewLocation, End))
+		{
+			++ImpactsCulledDistance;
+		}
+		else if (!FrameBudget.Consume(i / ShotsPerFrame, Budget))
+		{
+			++ImpactsCulledBudget;
+		}
+		else
+		{
+			++ImpactsPlayed;
+		}
+
+		SoundsPlayed += FBSEffectsLOD::IsSoundAudible(ViewLocation, End, SoundRange) ? 1 : 0;
+	}
+
+	const double Elapsed = FPlatformTime::Seconds() - StartTime;
+
+	UE_LOG(BattleStage, Display, TEXT("bs.BenchEffectsLOD: %d shots, %d per frame, radius %.0f"), Shots, ShotsPerFrame, Radius);
+	UE_LOG(BattleStage, Display, TEXT("  Tracers played: %d (%.1f%%)"), TracersPlayed, 100.f * TracersPlayed / Shots);
+	UE_LOG(BattleStage, Display, TEXT("  Impacts played: %d (%.1f%%), culled by distance: %d, culled by budget: %d"),
+		ImpactsPlayed, 100.f * ImpactsPlayed / Shots, ImpactsCulledDistance, ImpactsCulledBudget);
+	UE_LOG(BattleStage, Display, TEXT("  Impact sounds played: %d (%.1f%%)"), SoundsPlayed, 100.f * SoundsPlayed / Shots);
+	UE_LOG(BattleStage, Display, TEXT("  Policy cost: %.3f us per shot"), Elapsed * 1000000.0 / Shots);
+}
+
+static FAutoConsoleCommand BenchEffectsLODCommand(
+	TEXT("bs.BenchEffectsLOD"),
+	TEXT("Runs the shot cosmetic LOD policy over synthetic gunfire and logs what would be spawned. Args: [Shots] [ShotsPerFrame] [Radius] [SoundRange]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&BenchEffectsLOD));
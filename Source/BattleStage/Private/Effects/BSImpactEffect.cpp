@@ -2,11 +2,18 @@
 
 #include "BattleStage.h"
 #include "BSImpactEffect.h"
+#include "BSEffectsLOD.h"
+#include "BSImpactEffectPool.h"
 
 #include "Class.h"
 #include "PhysicalMaterials/PhysicalMaterial.h"
 
 void UBSImpactEffect::SpawnEffect(UWorld* World, const FHitResult& Hit) const
+{
+	SpawnEffectForSurface(World, Hit, UPhysicalMaterial::DetermineSurfaceType(Hit.PhysMaterial.Get()));
+}
+
+void UBSImpactEffect::SpawnEffectForSurface(UWorld* World, const FHitResult& Hit, const EPhysicalSurface SurfaceType) const
 {
 	if (!World)
 	{
@@ -14,20 +21,65 @@ void UBSImpactEffect::SpawnEffect(UWorld* World, const FHitResult& Hit) const
 	}
 	else
 	{	
-		const FMaterialEffect& Effect = GetEffect(Hit.PhysMaterial);
+		const FMaterialEffect& Effect = GetEffect(SurfaceType);
 		const FRotator Rotation = Hit.ImpactNormal.Rotation();
 
+		FVector ViewLocation;
+		if (!FBSEffectsLOD::GetViewLocation(World, ViewLocation))
+			return;
+
+		UBSImpactEffectPool* const Pool = UBSImpactEffectPool::Get(World);
+
+		if (Effect.Sound)
+		{
+			// Check range before spawning, an inaudible sound still costs an audio component
+			if (FBSEffectsLOD::IsSoundAudible(ViewLocation, Hit.ImpactPoint, Effect.Sound))
+			{
+				INC_DWORD_STAT(STAT_BSImpactSoundsPlayed);
+
+				if (Pool)
+				{
+					Pool->PlaySound(Effect.Sound, Hit.ImpactPoint, Rotation);
+				}
+				else
+				{
+					UGameplayStatics::SpawnSoundAtLocation(World, Effect.Sound, Hit.ImpactPoint, Rotation);
+				}
+			}
+			else
+			{
+				INC_DWORD_STAT(STAT_BSImpactSoundsCulled);
+			}
+		}
+
+		if (!FBSEffectsLOD::IsImpactRelevant(ViewLocation, Hit.ImpactPoint))
+		{
+			INC_DWORD_STAT(STAT_BSImpactsCulledDistance);
+			return;
+		}
+
+		if (!FBSEffectsLOD::ConsumeImpactBudget())
+		{
+			INC_DWORD_STAT(STAT_BSImpactsCulledBudget);
+			return;
+		}
+
+		INC_DWORD_STAT(STAT_BSImpactsPlayed);
+
 		if (Effect.Particles)
 		{
 			// Reflect the particle system on the surface
 			const FVector HitDirection = Hit.ImpactPoint - Hit.TraceStart;
 			const FVector ParticleDirection = HitDirection.MirrorByVector(Hit.ImpactNormal);
-			UGameplayStatics::SpawnEmitterAtLocation(World, Effect.Particles, Hit.ImpactPoint, ParticleDirection.Rotation());
-		}
 
-		if (Effect.Sound)
-		{
-			UGameplayStatics::SpawnSoundAtLocation(World, Effect.Sound, Hit.ImpactPoint, Rotation);
+			if (Pool)
+			{
+				Pool->PlayParticles(Effect.Particles, Hit.ImpactPoint, ParticleDirection.Rotation());
+			}
+			else
+			{
+				UGameplayStatics::SpawnEmitterAtLocation(World, Effect.Particles, Hit.ImpactPoint, ParticleDirection.Rotation());
+			}
 		}
 
 		if (DecalInfo.Material)
@@ -41,6 +93,14 @@ void UBSImpactEffect::SpawnEffect(UWorld* World, const FHitResult& Hit) const
 	}
 }
 
+void UBSImpactEffect::SpawnEffects(UWorld* World, const TArray<FHitResult>& Hits) const
+{
+	for (const FHitResult& Hit : Hits)
+	{
+		SpawnEffect(World, Hit);
+	}
+}
+
 void UBSImpactEffect::BeginDestroy()
 {
 	Super::BeginDestroy();
@@ -57,15 +117,7 @@ void UBSImpactEffect::BeginDestroy()
 	}	
 }
 
-const FMaterialEffect& UBSImpactEffect::GetEffect(TWeakObjectPtr<UPhysicalMaterial> Material) const
+const FMaterialEffect& UBSImpactEffect::GetEffect(const EPhysicalSurface SurfaceType) const
 {
-	if (Material.IsValid())
-	{
-		const int32 Index = static_cast<int32>(Material->SurfaceType.GetValue());
-		return SurfaceEffects[Index];
-	}
-	else
-	{
-		return SurfaceEffects[0];
-	}
+	return SurfaceEffects[static_cast<int32>(SurfaceType)];
 }
@@ -0,0 +1,166 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BattleStage.h"
+#include "BSImpactEffectPool.h"
+
+#include "Particles/ParticleSystemComponent.h"
+#include "Components/AudioComponent.h"
+
+static TAutoConsoleVariable<int32> CVarImpactParticlePoolSize(
+	TEXT("bs.ImpactParticlePoolSize"),
+	48,
+	TEXT("Max particle components pooled for impact effects, at least 1. The least recently used component is stolen when every one is busy."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<int32> CVarImpactAudioPoolSize(
+	TEXT("bs.ImpactAudioPoolSize"),
+	24,
+	TEXT("Max audio components pooled for impact effects, at least 1. The least recently used component is stolen when every one is busy."),
+	ECVF_Scalability);
+
+UBSImpactEffectPool* UBSImpactEffectPool::Get(const UWorld* World)
+{
+	const ABSGameState* const GameState = World ? World->GetGameState<ABSGameState>() : nullptr;
+	return GameState ? GameState->GetImpactEffectPool() : nullptr;
+}
+
+UWorld* UBSImpactEffectPool::GetWorld() const
+{
+	// The pool is outered to the game state that owns it
+	const AActor* const Owner = Cast<AActor>(GetOuter());
+	return Owner ? Owner->GetWorld() : nullptr;
+}
+
+void UBSImpactEffectPool::PlayParticles(UParticleSystem* Template, const FVector& Location, const FRotator& Rotation)
+{
+	UWorld* const World = GetWorld();
+	if (!Template || !World)
+		return;
+
+	int32 Index = INDEX_NONE;
+	const bool bStolen = ParticleBookkeeping.FindComponent(Template, CVarImpactParticlePoolSize.GetValueOnGameThread(), [this](const int32 i)
+	{
+		return !ParticleComponents[i]->IsActive();
+	}, Index);
+
+	UParticleSystemComponent* Component = nullptr;
+
+	if (Index == INDEX_NONE)
+	{
+		Component = NewObject<UParticleSystemComponent>(GetOuter());
+		Component->bAutoActivate = false;
+		Component->bAutoDestroy = false;
+		Component->SetTemplate(Template);
+		Component->SetWorldLocationAndRotation(Location, Rotation);
+		Component->RegisterComponentWithWorld(World);
+
+		Index = ParticleComponents.Add(Component);
+		ParticleBookkeeping.Add(Template);
+	}
+	else
+	{
+		Component = ParticleComponents[Index];
+
+		if (bStolen)
+		{
+			Component->DeactivateSystem();
+			Component->SetTemplate(Template);
+		}
+
+		Component->SetWorldLocationAndRotation(Location, Rotation);
+	}
+
+	ParticleBookkeeping.MarkUsed(Index);
+
+	Component->ActivateSystem(true);
+}
+
+void UBSImpactEffectPool::PlaySound(USoundBase* Sound, const FVector& Location, const FRotator& Rotation)
+{
+	UWorld* const World = GetWorld();
+	if (!Sound || !World)
+		return;
+
+	int32 Index = INDEX_NONE;
+	const bool bStolen = AudioBookkeeping.FindComponent(Sound, CVarImpactAudioPoolSize.GetValueOnGameThread(), [this](const int32 i)
+	{
+		return !AudioComponents[i]->IsPlaying();
+	}, Index);
+
+	UAudioComponent* Component = nullptr;
+
+	if (Index == INDEX_NONE)
+	{
+		Component = NewObject<UAudioComponent>(GetOuter());
+		Component->bAutoActivate = false;
+		Component->bAutoDestroy = false;
+		Component->bStopWhenOwnerDestroyed = true;
+		Component->SetSound(Sound);
+		Component->SetWorldLocationAndRotation(Location, Rotation);
+		Component->RegisterComponentWithWorld(World);
+
+		Index = AudioComponents.Add(Component);
+		AudioBookkeeping.Add(Sound);
+	}
+	else
+	{
+		Component = AudioComponents[Index];
+
+		if (bStolen)
+		{
+			Component->Stop();
+			Component->SetSound(Sound);
+		}
+
+		Component->SetWorldLocationAndRotation(Location, Rotation);
+	}
+
+	AudioBookkeeping.MarkUsed(Index);
+
+	Component->Play();
+}
+
+//-----------------------------------------------------------------
+// FBSEffectPoolBookkeeping
+//-----------------------------------------------------------------
+
+void FBSEffectPoolBookkeeping::Add(const UObject* Template)
+{
+	const int32 Index = Templates.Add(Template);
+	LastUsed.Add(0);
+
+	ComponentsByTemplate.FindOrAdd(Template).Add(Index);
+}
+
+void FBSEffectPoolBookkeeping::Rekey(const int32 Index, const UObject* Template)
+{
+	const UObject* const OldTemplate = Templates[Index];
+
+	if (TArray<int32>* const OldIndices = ComponentsByTemplate.Find(OldTemplate))
+	{
+		OldIndices->RemoveSingleSwap(Index);
+
+		if (OldIndices->Num() == 0)
+		{
+			ComponentsByTemplate.Remove(OldTemplate);
+		}
+	}
+
+	Templates[Index] = Template;
+	ComponentsByTemplate.FindOrAdd(Template).Add(Index);
+}
+
+int32 FBSEffectPoolBookkeeping::FindLeastRecentlyUsed() const
+{
+	int32 OldestIndex = INDEX_NONE;
+
+	for (int32 Index = 0; Index < LastUsed.Num(); ++Index)
+	{
+		if (OldestIndex == INDEX_NONE || LastUsed[Index] < LastUsed[OldestIndex])
+		{
+			OldestIndex = Index;
+		}
+	}
+
+	return OldestIndex;
+}
@@ -3,8 +3,31 @@
 #include "BattleStage.h"
 #include "BSGameState.h"
 
+#include "BSProjectileManager.h"
+#include "BSImpactEffectPool.h"
+
 DEFINE_LOG_CATEGORY_STATIC(ABSGameState, Warning, All);
 
+void ABSGameState::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	if (HasAuthority())
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.Owner = this;
+		SpawnParams.ObjectFlags |= RF_Transient;
+
+		UClass* const ManagerClass = ProjectileManagerClass ? *ProjectileManagerClass : ABSProjectileManager::StaticClass();
+		ProjectileManager = GetWorld()->SpawnActor<ABSProjectileManager>(ManagerClass, SpawnParams);
+	}
+
+	if (GetNetMode() != NM_DedicatedServer)
+	{
+		ImpactEffectPool = NewObject<UBSImpactEffectPool>(this);
+	}
+}
+
 void ABSGameState::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
@@ -13,6 +36,7 @@ void ABSGameState::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLife
 	DOREPLIFETIME_CONDITION(ABSGameState, ScoreGoal, COND_InitialOnly);
 
 	DOREPLIFETIME(ABSGameState, LastScoreEvent);
+	DOREPLIFETIME(ABSGameState, ProjectileManager);
 }
 
 void ABSGameState::AddScore(ABSPlayerState* Scorer, ABSPlayerState* Victim, const int32 Score, const EScoreType ScoreType)
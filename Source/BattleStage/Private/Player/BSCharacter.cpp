@@ -22,8 +22,9 @@ ABSCharacter::ABSCharacter(const FObjectInitializer& ObjectInitializer)
 	FirstPersonCamera->SetupAttachment(GetCapsuleComponent());
 
 	// Setup first person mesh.
-	// Only owner can see and does not replicate.
+	// Only owner can see and does not replicate. Only registered once the character is first person.
 	FirstPersonMesh = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("FirstPersonMesh"));
+	FirstPersonMesh->bAutoRegister = false;
 	FirstPersonMesh->SetupAttachment(FirstPersonCamera);
 	FirstPersonMesh->SetCastShadow(true);
 	FirstPersonMesh->bSelfShadowOnly = true;
@@ -45,6 +46,7 @@ ABSCharacter::ABSCharacter(const FObjectInitializer& ObjectInitializer)
 
 	bIsDying = false;
 	bIsRunning = false;
+	bReloadInputToggle = false;
 	Health = 100;
 	RunningMovementModifier = 1.5f;
 	CrouchCameraSpeed = 500.f;
@@ -190,7 +192,7 @@ const FReceiveHitInfo& ABSCharacter::GetLastHitInfo() const
 
 USkeletalMeshComponent* ABSCharacter::GetActiveMesh() const
 {
-	return IsFirstPerson() ? FirstPersonMesh : GetThirdPersonMesh();
+	return (IsFirstPerson() && FirstPersonMesh) ? FirstPersonMesh : GetThirdPersonMesh();
 }
 
 void ABSCharacter::Tick(float DeltaSeconds)
@@ -213,6 +215,11 @@ void ABSCharacter::Tick(float DeltaSeconds)
 	}
 
 	UpdateViewTarget(DeltaSeconds);
+
+	if (HasAuthority())
+	{
+		RecordHitbox();
+	}
 }
 
 void ABSCharacter::BeginPlay()
@@ -261,7 +268,7 @@ void ABSCharacter::TurnOff()
 {
 	StopFire();
 
-	if (GetNetMode() != NM_DedicatedServer && FirstPersonMesh != NULL)
+	if (FirstPersonMesh && FirstPersonMesh->IsRegistered())
 	{
 		FirstPersonMesh->bPauseAnims = true;
 		if (FirstPersonMesh->IsSimulatingPhysics())
@@ -278,6 +285,16 @@ void ABSCharacter::PostInitializeComponents()
 {
 	Super::PostInitializeComponents();
 
+	if (GetNetMode() == NM_DedicatedServer)
+	{
+		// Nobody views the character in first person on a dedicated server
+		FirstPersonMesh->DestroyComponent();
+		FirstPersonMesh = nullptr;
+
+		FirstPersonCamera->DestroyComponent();
+		FirstPersonCamera = nullptr;
+	}
+
 	if (HasAuthority())
 	{
 		CreateDefaultLoadout();
@@ -304,6 +321,9 @@ void ABSCharacter::OnStartCrouch(float HalfHeightAdjust, float ScaledHalfHeightA
 {
 	Super::OnStartCrouch(HalfHeightAdjust, ScaledHalfHeightAdjust);
 
+	if (!FirstPersonCamera)
+		return;
+
 	// Save eye height so we can lerp to new location following start crouch.
 	FVector NewCameraLocation = FirstPersonCamera->RelativeLocation;
 	NewCameraLocation.Z += HalfHeightAdjust;
@@ -316,6 +336,9 @@ void ABSCharacter::OnEndCrouch(float HalfHeightAdjust, float ScaledHalfHeightAdj
 {
 	Super::OnEndCrouch(HalfHeightAdjust, ScaledHalfHeightAdjust);
 
+	if (!FirstPersonCamera)
+		return;
+
 	// Save eye height so we can lerp to new location following start crouch.
 	FVector NewCameraLocation = FirstPersonCamera->RelativeLocation;
 	NewCameraLocation.Z -= HalfHeightAdjust;
@@ -402,6 +425,55 @@ void ABSCharacter::SwapWeapon()
 	}
 }
 
+void ABSCharacter::ApplyWeaponInput(const bool bTriggerHeld, const bool bReloadToggle, const EWeaponSlot InWeaponSlot, const float MoveTimeStamp)
+{
+	// Only a change of the toggle is a new reload
+	const bool bReload = bReloadToggle != bReloadInputToggle;
+	bReloadInputToggle = bReloadToggle;
+
+	ABSWeapon* Weapon = GetEquippedWeapon();
+
+	if (InWeaponSlot != ActiveWeaponSlot || (Weapon && Weapon->GetWeaponState() == EWeaponState::Inactive))
+	{
+		EquipWeapon(InWeaponSlot);
+
+		// The new weapon is equipping, so any other input applies to later moves
+		return;
+	}
+
+	if (!Weapon)
+		return;
+
+	// The client only reloads or fires once its previous equip or reload has finished. The server's
+	// transition started later than the client's, so catch it up to the move before applying the input.
+	if (bReload || bTriggerHeld)
+	{
+		Weapon->CatchUpTransition(MoveTimeStamp);
+	}
+
+	if (bReload)
+	{
+		Weapon->Reload();
+	}
+
+	if (bTriggerHeld)
+	{
+		if (Weapon->GetWeaponState() == EWeaponState::Active && !bIsActionsDisabled)
+		{
+			Weapon->StartFire();
+		}
+	}
+	else if (Weapon->GetWeaponState() == EWeaponState::Firing)
+	{
+		Weapon->StopFire();
+	}
+}
+
+void ABSCharacter::ToggleReloadInput()
+{
+	bReloadInputToggle = !bReloadInputToggle;
+}
+
 void ABSCharacter::SetupPlayerInputComponent(class UInputComponent* InInputComponent)
 {
 	Super::SetupPlayerInputComponent(InInputComponent);
@@ -421,10 +493,12 @@ void ABSCharacter::Die(FDamageEvent const& DamageEvent, AController* Killer)
 	// Detach controller, character will be destroyed soon
 	DetachFromControllerPendingDestroy();
 
+	// Torn off weapons send their final state and close their channels, dormant weapons included
 	for (int32 i = 0; i < (int32)EWeaponSlot::Max; ++i)
 	{
 		if (Weapons[i])
 		{
+			Weapons[i]->FlushNetDormancy();
 			Weapons[i]->TearOff();			
 		}
 	}
@@ -451,6 +525,8 @@ void ABSCharacter::OnRep_Weapons()
 		}		
 	}
 
+	PreloadLoadoutAssets();
+
 	if (IsLocallyControlled())
 	{
 		EquipWeapon(ActiveWeaponSlot);
@@ -474,7 +550,7 @@ void ABSCharacter::OnRep_Owner()
 
 void ABSCharacter::UpdateViewTarget(const float DeltaSeconds)
 {
-	if (FMath::Abs(LastEyeHeight - BaseEyeHeight) > 0.01f)
+	if (FirstPersonCamera && FMath::Abs(LastEyeHeight - BaseEyeHeight) > 0.01f)
 	{
 		// Get lerp alpha for camera from LastEyHeight to BaseEyeHeight
 		const float Distance = BaseEyeHeight - LastEyeHeight;
@@ -489,6 +565,15 @@ void ABSCharacter::UpdateViewTarget(const float DeltaSeconds)
 	}
 }
 
+void ABSCharacter::RecordHitbox()
+{
+	const UCapsuleComponent* const Capsule = GetCapsuleComponent();
+	HitboxHistory.Record(GetWorld()->GetTimeSeconds(), 
+		Capsule->GetComponentLocation(), 
+		Capsule->GetScaledCapsuleHalfHeight(), 
+		Capsule->GetScaledCapsuleRadius());
+}
+
 void ABSCharacter::TakeHit(const float Damage, FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
 {
 	SetReceiveHitInfo(Damage, DamageEvent, DamageCauser);
@@ -503,13 +588,13 @@ void ABSCharacter::TakeHit(const float Damage, FDamageEvent const& DamageEvent,
 		// Notify received damage on controller
 		if (ABSPlayerController* DamagedController = Cast<ABSPlayerController>(GetController()))
 		{
-			DamagedController->NotifyReceivedDamage(DamageCauser->GetActorLocation());
+			DamagedController->NotifyReceivedDamage(DamageCauser->GetActorLocation(), Damage);
 		}
 
 		// Notify hit if for controller that caused damage		
 		if (ABSPlayerController* InstigatorController = Cast<ABSPlayerController>(EventInstigator))
 		{
-			InstigatorController->NotifyWeaponHit();
+			InstigatorController->NotifyWeaponHit(Damage);
 		}
 	}
 }
@@ -557,6 +642,28 @@ void ABSCharacter::CreateDefaultLoadout()
 			Weapons[i] = GetWorld()->SpawnActor<ABSWeapon>(WeaponClass, SpawnParams);
 		}
 	}
+
+	PreloadLoadoutAssets();
+}
+
+void ABSCharacter::PreloadLoadoutAssets()
+{
+	if (GetNetMode() == NM_DedicatedServer)
+		return;
+
+	// Equipped weapon first, it is drawn as soon as the character spawns
+	if (auto Weapon = GetEquippedWeapon())
+	{
+		Weapon->PreloadCosmeticAssets();
+	}
+
+	for (int32 i = 0; i < (int32)EWeaponSlot::Max; ++i)
+	{
+		if (Weapons[i])
+		{
+			Weapons[i]->PreloadCosmeticAssets();
+		}
+	}
 }
 
 void ABSCharacter::OnReceiveHit_Implementation()
@@ -635,8 +742,17 @@ void ABSCharacter::UpdateMeshVisibility()
 	GetMesh()->SetOwnerNoSee(bIsFirstPerson);
 	GetMesh()->MeshComponentUpdateFlag = bIsFirstPerson ? EMeshComponentUpdateFlag::OnlyTickPoseWhenRendered : EMeshComponentUpdateFlag::AlwaysTickPoseAndRefreshBones;
 
-	FirstPersonMesh->SetOwnerNoSee(!bIsFirstPerson);
-	FirstPersonMesh->MeshComponentUpdateFlag = bIsFirstPerson ? EMeshComponentUpdateFlag::AlwaysTickPoseAndRefreshBones : EMeshComponentUpdateFlag::OnlyTickPoseWhenRendered;
+	if (FirstPersonMesh)
+	{
+		// Registered the first time the character is viewed in first person, other characters never pay for it
+		if (bIsFirstPerson && !FirstPersonMesh->IsRegistered())
+		{
+			FirstPersonMesh->RegisterComponent();
+		}
+
+		FirstPersonMesh->SetOwnerNoSee(!bIsFirstPerson);
+		FirstPersonMesh->MeshComponentUpdateFlag = bIsFirstPerson ? EMeshComponentUpdateFlag::AlwaysTickPoseAndRefreshBones : EMeshComponentUpdateFlag::OnlyTickPoseWhenRendered;
+	}
 }
 
 void ABSCharacter::PossessedBy(AController* NewController)
@@ -645,6 +761,15 @@ void ABSCharacter::PossessedBy(AController* NewController)
 
 	SetOwner(NewController);
 
+	// Owner only properties of holstered weapons need to reach the new owning connection
+	for (int32 i = 0; i < (int32)EWeaponSlot::Max; ++i)
+	{
+		if (Weapons[i])
+		{
+			Weapons[i]->FlushNetDormancy();
+		}
+	}
+
 	if (auto Weapon = GetEquippedWeapon())
 	{
 		Weapon->AttachToOwner();
@@ -673,19 +798,4 @@ void ABSCharacter::EquipWeapon(const EWeaponSlot InWeaponSlot)
 	{
 		NewWeapon->Equip();
 	}
-
-	if (!HasAuthority())
-	{
-		ServerEquipWeapon(InWeaponSlot);
-	}
-}
-
-void ABSCharacter::ServerEquipWeapon_Implementation(const EWeaponSlot InWeaponSlot)
-{
-	EquipWeapon(InWeaponSlot);
-}
-
-bool ABSCharacter::ServerEquipWeapon_Validate(const EWeaponSlot InWeaponSlot)
-{
-	return InWeaponSlot == EWeaponSlot::Primary || InWeaponSlot == EWeaponSlot::Secondary;
 }
\ No newline at end of file
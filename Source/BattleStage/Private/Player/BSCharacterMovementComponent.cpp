@@ -3,6 +3,8 @@
 #include "BattleStage.h"
 #include "BSCharacterMovementComponent.h"
 
+#include "BSWeapon.h"
+
 UBSCharacterMovementComponent::UBSCharacterMovementComponent(const FObjectInitializer& ObjectInitializer /*= FObjectInitializer::Get()*/)
 	: Super(ObjectInitializer)
 {
@@ -25,3 +27,114 @@ float UBSCharacterMovementComponent::GetMaxSpeed() const
 
 	return MaxSpeed;
 }
+
+float UBSCharacterMovementComponent::GetClientMoveTimeStamp() const
+{
+	const FNetworkPredictionData_Client_Character* const ClientData = HasPredictionData_Client() ? GetPredictionData_Client_Character() : nullptr;
+	return ClientData ? ClientData->CurrentTimeStamp : 0.f;
+}
+
+float UBSCharacterMovementComponent::GetServerMoveTimeStamp() const
+{
+	const FNetworkPredictionData_Server_Character* const ServerData = HasPredictionData_Server() ? GetPredictionData_Server_Character() : nullptr;
+	return ServerData ? ServerData->CurrentClientTimeStamp : 0.f;
+}
+
+FNetworkPredictionData_Client* UBSCharacterMovementComponent::GetPredictionData_Client() const
+{
+	if (!ClientPredictionData)
+	{
+		UBSCharacterMovementComponent* MutableThis = const_cast<UBSCharacterMovementComponent*>(this);
+		MutableThis->ClientPredictionData = new FNetworkPredictionData_Client_BSCharacter(*this);
+	}
+
+	return ClientPredictionData;
+}
+
+void UBSCharacterMovementComponent::UpdateFromCompressedFlags(uint8 Flags)
+{
+	Super::UpdateFromCompressedFlags(Flags);
+
+	// Flags are also applied when the owning client replays moves, but the client's weapon
+	// state is already ahead of the replayed moves. Only the server follows the client's input.
+	ABSCharacter* BSCharacter = Cast<ABSCharacter>(CharacterOwner);
+	if (BSCharacter && BSCharacter->Role == ROLE_Authority && !BSCharacter->IsLocallyControlled())
+	{
+		const bool bTriggerHeld = (Flags & FSavedMove_BSCharacter::FLAG_TriggerHeld) != 0;
+		const bool bReloadToggle = (Flags & FSavedMove_BSCharacter::FLAG_Reload) != 0;
+		const EWeaponSlot WeaponSlot = (Flags & FSavedMove_BSCharacter::FLAG_SecondarySlot) ? EWeaponSlot::Secondary : EWeaponSlot::Primary;
+
+		// The server's current client timestamp is the one of the move being applied
+		BSCharacter->ApplyWeaponInput(bTriggerHeld, bReloadToggle, WeaponSlot, GetServerMoveTimeStamp());
+	}
+}
+
+//-----------------------------------------------------------------
+// FSavedMove_BSCharacter
+//-----------------------------------------------------------------
+
+void FSavedMove_BSCharacter::Clear()
+{
+	Super::Clear();
+
+	bTriggerHeld = false;
+	bReloadToggle = false;
+	bSecondarySlot = false;
+}
+
+uint8 FSavedMove_BSCharacter::GetCompressedFlags() const
+{
+	uint8 Flags = Super::GetCompressedFlags();
+
+	if (bTriggerHeld)
+		Flags |= FLAG_TriggerHeld;
+
+	if (bReloadToggle)
+		Flags |= FLAG_Reload;
+
+	if (bSecondarySlot)
+		Flags |= FLAG_SecondarySlot;
+
+	return Flags;
+}
+
+bool FSavedMove_BSCharacter::CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const
+{
+	const FSavedMove_BSCharacter* const NewBSMove = static_cast<const FSavedMove_BSCharacter*>(NewMove.Get());
+
+	// Weapon transitions must reach the server with the move they happened on
+	if (bTriggerHeld != NewBSMove->bTriggerHeld || bReloadToggle != NewBSMove->bReloadToggle || bSecondarySlot != NewBSMove->bSecondarySlot)
+		return false;
+
+	return Super::CanCombineWith(NewMove, InCharacter, MaxDelta);
+}
+
+void FSavedMove_BSCharacter::SetMoveFor(ACharacter* Character, float InDeltaTime, FVector const& NewAccel, FNetworkPredictionData_Client_Character& ClientData)
+{
+	Super::SetMoveFor(Character, InDeltaTime, NewAccel, ClientData);
+
+	if (ABSCharacter* const BSCharacter = Cast<ABSCharacter>(Character))
+	{
+		bSecondarySlot = BSCharacter->GetActiveWeaponSlot() == EWeaponSlot::Secondary;
+		bReloadToggle = BSCharacter->GetReloadInputToggle();
+
+		if (ABSWeapon* const Weapon = BSCharacter->GetEquippedWeapon())
+		{
+			bTriggerHeld = Weapon->GetWeaponState() == EWeaponState::Firing;
+		}
+	}
+}
+
+//-----------------------------------------------------------------
+// FNetworkPredictionData_Client_BSCharacter
+//-----------------------------------------------------------------
+
+FNetworkPredictionData_Client_BSCharacter::FNetworkPredictionData_Client_BSCharacter(const UCharacterMovementComponent& ClientMovement)
+	: Super(ClientMovement)
+{
+}
+
+FSavedMovePtr FNetworkPredictionData_Client_BSCharacter::AllocateNewMove()
+{
+	return FSavedMovePtr(new FSavedMove_BSCharacter());
+}
@@ -0,0 +1,168 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BattleStage.h"
+#include "BSLagCompensation.h"
+
+#include "EngineUtils.h"
+
+// Max seconds a character will be rewound. Clients with higher latency will be
+// validated against the oldest allowed position.
+static const float MAX_REWIND_TIME = 0.4f;
+
+// Max distance a shot may start from the shooter's eyes. Covers the muzzle distance aim
+// locations are moved forward by, and movement between recorded frames.
+static const float MAX_SHOT_START_OFFSET = 150.f;
+
+// Distance added to hitbox radii to tolerate interpolation and quantization error.
+static const float HITBOX_TOLERANCE = 15.f;
+
+void FBSHitboxHistory::Record(const float Time, const FVector& Center, const float HalfHeight, const float Radius)
+{
+	FBSHitboxFrame& Frame = Frames[Head];
+	Frame.Time = Time;
+	Frame.Center = Center;
+	Frame.HalfHeight = HalfHeight;
+	Frame.Radius = Radius;
+
+	Head = (Head + 1) % MAX_FRAMES;
+	Count = FMath::Min(Count + 1, MAX_FRAMES);
+}
+
+bool FBSHitboxHistory::GetFrameAtTime(const float Time, FBSHitboxFrame& OutFrame) const
+{
+	if (Count == 0)
+	{
+		return false;
+	}
+
+	// Search from the newest frame since most rewinds are only a few frames back.
+	for (int32 i = Count - 1; i > 0; --i)
+	{
+		const FBSHitboxFrame& Newer = GetFrame(i);
+		if (Newer.Time <= Time)
+		{
+			OutFrame = Newer;
+			return true;
+		}
+
+		const FBSHitboxFrame& Older = GetFrame(i - 1);
+		if (Older.Time <= Time)
+		{
+			const float Alpha = (Time - Older.Time) / FMath::Max(Newer.Time - Older.Time, KINDA_SMALL_NUMBER);
+
+			OutFrame.Time = Time;
+			OutFrame.Center = FMath::Lerp(Older.Center, Newer.Center, Alpha);
+			OutFrame.HalfHeight = FMath::Lerp(Older.HalfHeight, Newer.HalfHeight, Alpha);
+			OutFrame.Radius = FMath::Lerp(Older.Radius, Newer.Radius, Alpha);
+			return true;
+		}
+	}
+
+	// Older than any recorded frame, use the oldest
+	OutFrame = GetFrame(0);
+	return true;
+}
+
+void FBSHitboxHistory::Reset()
+{
+	Head = 0;
+	Count = 0;
+}
+
+const FBSHitboxFrame& FBSHitboxHistory::GetFrame(const int32 Index) const
+{
+	const int32 Oldest = (Head - Count + MAX_FRAMES) % MAX_FRAMES;
+	return Frames[(Oldest + Index) % MAX_FRAMES];
+}
+
+float FBSLagCompensation::GetRewindTime(const AController* Shooter, const UWorld* World, const float TimeBeforeLatest)
+{
+	float Latency = 0.f;
+
+	if (const APlayerController* const PlayerController = Cast<APlayerController>(Shooter))
+	{
+		// Remote controllers see other characters one round trip in the past by the time
+		// their shot is processed on the server.
+		if (!PlayerController->IsLocalController() && PlayerController->PlayerState)
+		{
+			Latency = PlayerController->PlayerState->ExactPing * 0.001f;
+		}
+	}
+
+	const float RewindDuration = Latency + FMath::Max(0.f, TimeBeforeLatest);
+	return World->GetTimeSeconds() - FMath::Min(RewindDuration, MAX_REWIND_TIME);
+}
+
+bool FBSLagCompensation::RewindTraceCharacter(const ABSCharacter& Character, const FVector& Start, const FVector& End, const float RewindTime, FVector& OutLocation)
+{
+	FBSHitboxFrame Frame;
+	if (!Character.GetHitboxHistory().GetFrameAtTime(RewindTime, Frame))
+	{
+		return false;
+	}
+
+	// Capsule axis, excluding the hemisphere caps
+	const float AxisHalfLength = FMath::Max(0.f, Frame.HalfHeight - Frame.Radius);
+	const FVector AxisTop = Frame.Center + FVector(0.f, 0.f, AxisHalfLength);
+	const FVector AxisBottom = Frame.Center - FVector(0.f, 0.f, AxisHalfLength);
+
+	FVector TracePoint, AxisPoint;
+	FMath::SegmentDistToSegmentSafe(Start, End, AxisBottom, AxisTop, TracePoint, AxisPoint);
+
+	const float HitRadius = Frame.Radius + HITBOX_TOLERANCE;
+	if (FVector::DistSquared(TracePoint, AxisPoint) <= FMath::Square(HitRadius))
+	{
+		OutLocation = TracePoint;
+		return true;
+	}
+
+	return false;
+}
+
+void FBSLagCompensation::RewindTraceMulti(UWorld* World, const FVector& Start, const FVector& End, const float RewindTime, const AActor* IgnoreActor, TArray<FRewoundHit>& OutHits)
+{
+	for (TActorIterator<ABSCharacter> It(World); It; ++It)
+	{
+		ABSCharacter* const Character = *It;
+
+		if (Character == IgnoreActor || Character->GetHealth() <= 0)
+			continue;
+
+		FVector HitLocation;
+		if (RewindTraceCharacter(*Character, Start, End, RewindTime, HitLocation))
+		{
+			FRewoundHit Hit;
+			Hit.Character = Character;
+			Hit.Location = HitLocation;
+			Hit.Distance = FVector::Dist(Start, HitLocation);
+			OutHits.Add(Hit);
+		}
+	}
+
+	OutHits.Sort([](const FRewoundHit& A, const FRewoundHit& B) { return A.Distance < B.Distance; });
+}
+
+bool FBSLagCompensation::IsOccluded(UWorld* World, const FVector& Start, const FVector& End, const AActor* IgnoreActor)
+{
+	static const FName OcclusionTraceTag(TEXT("LagCompensationOcclusion"));
+
+	FCollisionQueryParams QueryParams(OcclusionTraceTag, false, IgnoreActor);
+	return World->LineTraceTestByObjectType(Start, End, FCollisionObjectQueryParams(ECC_WorldStatic), QueryParams);
+}
+
+bool FBSLagCompensation::IsShotStartValid(UWorld* World, const ABSCharacter& Shooter, const FVector& Start, const float ShotTime)
+{
+	// The shooter's capsule is centered on its location, so the eyes are BaseEyeHeight above the rewound center
+	FVector EyeLocation = Shooter.GetPawnViewLocation();
+
+	FBSHitboxFrame Frame;
+	if (Shooter.GetHitboxHistory().GetFrameAtTime(ShotTime, Frame))
+	{
+		EyeLocation = Frame.Center + FVector(0.f, 0.f, Shooter.BaseEyeHeight);
+	}
+
+	if (FVector::DistSquared(EyeLocation, Start) > FMath::Square(MAX_SHOT_START_OFFSET))
+		return false;
+
+	return !IsOccluded(World, EyeLocation, Start, &Shooter);
+}
@@ -12,6 +12,39 @@
 
 #define LOCTEXT_NAMESPACE "BattleStage.PlayerController"
 
+bool FDamageFeedback::SerializeShotIndices(FArchive& Ar, TArray<uint16>& ShotIndices)
+{
+	uint32 Count = ShotIndices.Num();
+	Ar.SerializeIntPacked(Count);
+
+	if (Count > MAX_FEEDBACK_SHOT_RESULTS)
+		return false;
+
+	if (Ar.IsLoading())
+	{
+		ShotIndices.SetNumUninitialized(Count);
+	}
+
+	for (uint16& ShotIndex : ShotIndices)
+	{
+		Ar << ShotIndex;
+	}
+
+	return true;
+}
+
+bool FDamageFeedback::SerializeShotResults(FArchive& Ar, UPackageMap* Map)
+{
+	UObject* Weapon = ShotWeapon;
+	bool bSuccess = Map->SerializeObject(Ar, ABSWeapon::StaticClass(), Weapon);
+	ShotWeapon = Cast<ABSWeapon>(Weapon);
+
+	bSuccess &= SerializeShotIndices(Ar, ConfirmedShots);
+	bSuccess &= SerializeShotIndices(Ar, RejectedShots);
+
+	return bSuccess;
+}
+
 ABSPlayerController::ABSPlayerController()
 	: Super()
 	, BSCharacter(nullptr)
@@ -42,22 +75,67 @@ void ABSPlayerController::PawnPendingDestroy(APawn* inPawn)
 	ClientSetSpectatorCamera(DeathLocation, CameraRotation);
 }
 
-void ABSPlayerController::NotifyWeaponHit()
+void ABSPlayerController::NotifyWeaponHit(const float Damage)
 {
-	ClientNotifyWeaponHit();
+	ScheduleDamageFeedbackFlush();
+
+	PendingDamageFeedback.AddHitDealt(Damage);
 }
 
-void ABSPlayerController::ClientNotifyWeaponHit_Implementation()
+void ABSPlayerController::NotifyReceivedDamage(const FVector& SourcePosition, const float Damage)
 {
-	if (ABSHUD* HUD = Cast<ABSHUD>(GetHUD()))
+	ScheduleDamageFeedbackFlush();
+
+	PendingDamageFeedback.AddHitReceived(Damage, SourcePosition);
+}
+
+void ABSPlayerController::NotifyShotResult(ABSWeapon* Weapon, const uint16 ShotIndex, const bool bConfirmed)
+{
+	// A message holds the results of a single weapon, send the other weapon's results first
+	const int32 ResultCount = PendingDamageFeedback.ConfirmedShots.Num() + PendingDamageFeedback.RejectedShots.Num();
+	if (PendingDamageFeedback.HasShotResults() && (PendingDamageFeedback.ShotWeapon != Weapon || ResultCount >= MAX_FEEDBACK_SHOT_RESULTS))
+	{
+		FlushDamageFeedback();
+	}
+
+	ScheduleDamageFeedbackFlush();
+
+	PendingDamageFeedback.ShotWeapon = Weapon;
+
+	if (bConfirmed)
 	{
-		HUD->NotifyWeaponHit();
+		PendingDamageFeedback.ConfirmedShots.Add(ShotIndex);
+	}
+	else
+	{
+		PendingDamageFeedback.RejectedShots.Add(ShotIndex);
+	}
+}
+
+void ABSPlayerController::NotifyPredictedHit(ABSWeapon* Weapon, const uint16 ShotIndex)
+{
+	if (ABSHUD* const HUD = Cast<ABSHUD>(GetHUD()))
+	{
+		HUD->NotifyPredictedHit(Weapon, ShotIndex);
+	}
+}
+
+void ABSPlayerController::ScheduleDamageFeedbackFlush()
+{
+	if (!PendingDamageFeedback.HasFeedback())
+	{
+		// First feedback of the frame. Send it along with any other feedback this frame.
+		GetWorldTimerManager().SetTimerForNextTick(this, &ABSPlayerController::FlushDamageFeedback);
 	}
 }
 
-void ABSPlayerController::NotifyReceivedDamage(const FVector& SourcePosition)
+void ABSPlayerController::FlushDamageFeedback()
 {
-	ClientNotifyReceivedDamage(SourcePosition);
+	if (PendingDamageFeedback.HasFeedback())
+	{
+		ClientReceiveDamageFeedback(PendingDamageFeedback);
+		PendingDamageFeedback = FDamageFeedback();
+	}
 }
 
 void ABSPlayerController::ToggleInGameMenu()
@@ -169,16 +247,31 @@ void ABSPlayerController::BeginInactiveState()
 	}
 }
 
-void ABSPlayerController::ClientNotifyReceivedDamage_Implementation(const FVector& SourcePosition)
+void ABSPlayerController::ClientReceiveDamageFeedback_Implementation(const FDamageFeedback& Feedback)
 {
-	if (ABSHUD* HUD = Cast<ABSHUD>(GetHUD()))
+	ABSHUD* const HUD = Cast<ABSHUD>(GetHUD());
+
+	if (Feedback.HasShotResults() && HUD)
 	{
-		HUD->NotifyReceivedDamage(SourcePosition);
+		HUD->NotifyShotResults(Feedback.ShotWeapon, Feedback.ConfirmedShots, Feedback.RejectedShots);
 	}
 
-	if (HitCameraShake)
+	if (Feedback.HitsDealt > 0 && HUD)
 	{
-		PlayerCameraManager->PlayCameraShake(HitCameraShake);
+		HUD->NotifyWeaponHit(Feedback.DamageDealt);
+	}
+
+	if (Feedback.HitsReceived > 0)
+	{
+		if (HUD)
+		{
+			HUD->NotifyReceivedDamage(Feedback.StrongestSourceLocation, Feedback.DamageReceived);
+		}
+
+		if (HitCameraShake)
+		{
+			PlayerCameraManager->PlayCameraShake(HitCameraShake);
+		}
 	}
 }
 
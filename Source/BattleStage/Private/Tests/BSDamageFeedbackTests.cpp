@@ -0,0 +1,116 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BattleStage.h"
+#include "BSPlayerController.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/** Writes damage feedback without shot results and reads it back. Returns false on a serialization error. */
+static bool RoundTripFeedback(const FDamageFeedback& Feedback, FDamageFeedback& OutFeedback)
+{
+	FDamageFeedback WriteFeedback = Feedback;
+	bool bWriteSuccess = false;
+
+	FBitWriter Writer(256, true);
+	WriteFeedback.NetSerialize(Writer, nullptr, bWriteSuccess);
+
+	bool bReadSuccess = false;
+
+	FBitReader Reader(Writer.GetData(), Writer.GetNumBits());
+	OutFeedback.NetSerialize(Reader, nullptr, bReadSuccess);
+
+	return bWriteSuccess && bReadSuccess && !Writer.IsError() && !Reader.IsError();
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDamageFeedbackRoundTripTest, "BattleStage.Player.DamageFeedback.RoundTrip", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FDamageFeedbackRoundTripTest::RunTest(const FString& Parameters)
+{
+	// Hits dealt only
+	{
+		FDamageFeedback Feedback;
+		Feedback.AddHitDealt(25.f);
+		Feedback.AddHitDealt(12.6f);
+
+		FDamageFeedback Result;
+		TestTrue(TEXT("Hits dealt serialize"), RoundTripFeedback(Feedback, Result));
+		TestEqual(TEXT("Hits dealt round trip"), static_cast<int32>(Result.HitsDealt), 2);
+		TestEqual(TEXT("Damage dealt round trips"), static_cast<int32>(Result.DamageDealt), 38);
+		TestEqual(TEXT("No hits received are read"), static_cast<int32>(Result.HitsReceived), 0);
+		TestEqual(TEXT("No damage received is read"), static_cast<int32>(Result.DamageReceived), 0);
+	}
+
+	// Hits received keep the strongest source
+	{
+		FDamageFeedback Feedback;
+		Feedback.AddHitReceived(10.f, FVector(100.f, 0.f, 0.f));
+		Feedback.AddHitReceived(40.f, FVector(-250.f, 310.f, 12.f));
+		Feedback.AddHitReceived(20.f, FVector(0.f, 500.f, 0.f));
+
+		FDamageFeedback Result;
+		TestTrue(TEXT("Hits received serialize"), RoundTripFeedback(Feedback, Result));
+		TestEqual(TEXT("Hits received round trip"), static_cast<int32>(Result.HitsReceived), 3);
+		TestEqual(TEXT("Damage received round trips"), static_cast<int32>(Result.DamageReceived), 70);
+		TestEqual(TEXT("No hits dealt are read"), static_cast<int32>(Result.HitsDealt), 0);
+		TestEqual(TEXT("Strongest source round trips"), FVector(Result.StrongestSourceLocation), FVector(-250.f, 310.f, 12.f));
+	}
+
+	// Hit counts and damage totals saturate instead of wrapping
+	{
+		FDamageFeedback Feedback;
+		for (int32 i = 0; i < 300; ++i)
+		{
+			Feedback.AddHitDealt(1000.f);
+		}
+
+		FDamageFeedback Result;
+		RoundTripFeedback(Feedback, Result);
+		TestEqual(TEXT("Hits dealt saturate"), static_cast<int32>(Result.HitsDealt), static_cast<int32>(MAX_uint8));
+		TestEqual(TEXT("Damage dealt saturates"), static_cast<int32>(Result.DamageDealt), static_cast<int32>(MAX_uint16));
+	}
+
+	// Negative damage doesn't reduce the totals
+	{
+		FDamageFeedback Feedback;
+		Feedback.AddHitDealt(30.f);
+		Feedback.AddHitDealt(-20.f);
+
+		FDamageFeedback Result;
+		RoundTripFeedback(Feedback, Result);
+		TestEqual(TEXT("Negative damage is ignored"), static_cast<int32>(Result.DamageDealt), 30);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDamageFeedbackShotIndicesTest, "BattleStage.Player.DamageFeedback.ShotIndices", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FDamageFeedbackShotIndicesTest::RunTest(const FString& Parameters)
+{
+	// Indices round trip in order, including the ends of the range
+	{
+		TArray<uint16> ShotIndices = { 0, 1, 1000, MAX_uint16 };
+
+		FBitWriter Writer(256, true);
+		TestTrue(TEXT("Shot indices serialize"), FDamageFeedback::SerializeShotIndices(Writer, ShotIndices));
+
+		TArray<uint16> Result;
+
+		FBitReader Reader(Writer.GetData(), Writer.GetNumBits());
+		TestTrue(TEXT("Shot indices deserialize"), FDamageFeedback::SerializeShotIndices(Reader, Result));
+		TestTrue(TEXT("Shot indices round trip"), Result == ShotIndices);
+	}
+
+	// Lists longer than MAX_FEEDBACK_SHOT_RESULTS are rejected before reading them
+	{
+		TArray<uint16> ShotIndices;
+		ShotIndices.SetNumZeroed(MAX_FEEDBACK_SHOT_RESULTS + 1);
+
+		FBitWriter Writer(0, true);
+		TestFalse(TEXT("Too many shot indices are rejected"), FDamageFeedback::SerializeShotIndices(Writer, ShotIndices));
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
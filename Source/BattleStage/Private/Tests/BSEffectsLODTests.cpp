@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BattleStage.h"
+#include "BSEffectsLOD.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/** Gets the current value of a float console variable, so tests follow the active scalability settings. */
+static float GetCVarFloat(const TCHAR* Name)
+{
+	const IConsoleVariable* const CVar = IConsoleManager::Get().FindConsoleVariable(Name);
+	return CVar ? CVar->GetFloat() : 0.f;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FEffectBudgetTest, "BattleStage.Effects.LOD.Budget", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FEffectBudgetTest::RunTest(const FString& Parameters)
+{
+	FBSEffectBudget Budget;
+
+	TestTrue(TEXT("First effect of a frame is within budget"), Budget.Consume(1, 2));
+	TestTrue(TEXT("Last effect of the budget is within budget"), Budget.Consume(1, 2));
+	TestFalse(TEXT("Effect over budget is rejected"), Budget.Consume(1, 2));
+
+	TestTrue(TEXT("Budget resets on a new frame"), Budget.Consume(2, 2));
+
+	TestFalse(TEXT("A budget of zero rejects every effect"), Budget.Consume(3, 0));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FEffectsLODRelevancyTest, "BattleStage.Effects.LOD.Relevancy", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FEffectsLODRelevancyTest::RunTest(const FString& Parameters)
+{
+	const FVector ViewLocation(100.f, -200.f, 50.f);
+	const FVector Side = FVector::RightVector;
+
+	// Tracers are relevant when any part of them passes close to the view
+	const float TracerDistance = GetCVarFloat(TEXT("bs.TracerDistance"));
+	if (TracerDistance > 0.f)
+	{
+		const FVector Near = ViewLocation + Side * (TracerDistance * 0.5f);
+		const FVector Far = ViewLocation + Side * (TracerDistance * 2.f);
+
+		TestTrue(TEXT("Tracer passing near the view is relevant"), FBSEffectsLOD::IsTracerRelevant(ViewLocation, Near - FVector::ForwardVector * 100000.f, Near + FVector::ForwardVector * 100000.f));
+		TestFalse(TEXT("Tracer passing far from the view is culled"), FBSEffectsLOD::IsTracerRelevant(ViewLocation, Far - FVector::ForwardVector * 100000.f, Far + FVector::ForwardVector * 100000.f));
+		TestTrue(TEXT("Tracer ending near the view is relevant"), FBSEffectsLOD::IsTracerRelevant(ViewLocation, Far, Near));
+	}
+
+	// Impacts are relevant within the impact effect distance
+	const float ImpactDistance = GetCVarFloat(TEXT("bs.ImpactEffectDistance"));
+	TestTrue(TEXT("Impact within distance is relevant"), FBSEffectsLOD::IsImpactRelevant(ViewLocation, ViewLocation + Side * (ImpactDistance * 0.5f)));
+	TestFalse(TEXT("Impact past distance is culled"), FBSEffectsLOD::IsImpactRelevant(ViewLocation, ViewLocation + Side * (ImpactDistance * 1.5f + 1.f)));
+
+	// Sounds are audible within their attenuation, scaled by bs.ImpactSoundRangeScale
+	const float SoundRange = 1000.f * GetCVarFloat(TEXT("bs.ImpactSoundRangeScale"));
+	TestTrue(TEXT("Sound within range is audible"), FBSEffectsLOD::IsSoundAudible(ViewLocation, ViewLocation + Side * (SoundRange * 0.5f), 1000.f));
+	TestFalse(TEXT("Sound past range is culled"), FBSEffectsLOD::IsSoundAudible(ViewLocation, ViewLocation + Side * (SoundRange * 1.5f + 1.f), 1000.f));
+	TestFalse(TEXT("Missing sound asset is never audible"), FBSEffectsLOD::IsSoundAudible(ViewLocation, ViewLocation, static_cast<USoundBase*>(nullptr)));
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
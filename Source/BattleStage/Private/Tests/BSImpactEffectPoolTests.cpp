@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BattleStage.h"
+#include "BSImpactEffectPool.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/** Finds a component for a template and adds a new one when the pool asks for it, like UBSImpactEffectPool does. */
+static int32 PlayTemplate(FBSEffectPoolBookkeeping& Bookkeeping, TArray<bool>& Busy, const UObject* Template, const int32 MaxComponents, bool& bOutStolen)
+{
+	int32 Index = INDEX_NONE;
+	bOutStolen = Bookkeeping.FindComponent(Template, MaxComponents, [&Busy](const int32 i) { return !Busy[i]; }, Index);
+
+	if (Index == INDEX_NONE)
+	{
+		Bookkeeping.Add(Template);
+		Index = Busy.Add(false);
+	}
+
+	Bookkeeping.MarkUsed(Index);
+	Busy[Index] = true;
+
+	return Index;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FEffectPoolStealTest, "BattleStage.Effects.ImpactEffectPool.Steal", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FEffectPoolStealTest::RunTest(const FString& Parameters)
+{
+	// Templates are only compared, any distinct objects will do
+	const UObject* const TemplateA = UObject::StaticClass();
+	const UObject* const TemplateB = UClass::StaticClass();
+	const UObject* const TemplateC = UPackage::StaticClass();
+
+	bool bStolen = false;
+
+	// Finished components of the same template are reused
+	{
+		FBSEffectPoolBookkeeping Bookkeeping;
+		TArray<bool> Busy;
+
+		const int32 First = PlayTemplate(Bookkeeping, Busy, TemplateA, 4, bStolen);
+		Busy[First] = false;
+
+		TestEqual(TEXT("Finished component is reused"), PlayTemplate(Bookkeeping, Busy, TemplateA, 4, bStolen), First);
+		TestFalse(TEXT("Reusing a component of the same template is not a steal"), bStolen);
+		TestEqual(TEXT("No component is added when one is free"), Bookkeeping.Num(), 1);
+	}
+
+	// A full pool restarts the oldest component of the same template
+	{
+		FBSEffectPoolBookkeeping Bookkeeping;
+		TArray<bool> Busy;
+
+		const int32 Oldest = PlayTemplate(Bookkeeping, Busy, TemplateA, 2, bStolen);
+		PlayTemplate(Bookkeeping, Busy, TemplateA, 2, bStolen);
+
+		TestEqual(TEXT("Oldest component of the template is restarted"), PlayTemplate(Bookkeeping, Busy, TemplateA, 2, bStolen), Oldest);
+		TestFalse(TEXT("Restarting a component of the same template is not a steal"), bStolen);
+	}
+
+	// A full pool prefers a finished component of another template to the least recently used one
+	{
+		FBSEffectPoolBookkeeping Bookkeeping;
+		TArray<bool> Busy;
+
+		PlayTemplate(Bookkeeping, Busy, TemplateA, 2, bStolen);
+		const int32 Finished = PlayTemplate(Bookkeeping, Busy, TemplateB, 2, bStolen);
+		Busy[Finished] = false;
+
+		TestEqual(TEXT("Finished component is stolen first"), PlayTemplate(Bookkeeping, Busy, TemplateC, 2, bStolen), Finished);
+		TestTrue(TEXT("Component of another template is stolen"), bStolen);
+		TestNull(TEXT("Stolen component's template has no components left"), Bookkeeping.ComponentsByTemplate.Find(TemplateB));
+		TestTrue(TEXT("Stolen component is keyed by its new template"), Bookkeeping.Templates[Finished] == TemplateC);
+	}
+
+	// A full pool of busy components steals the least recently used one
+	{
+		FBSEffectPoolBookkeeping Bookkeeping;
+		TArray<bool> Busy;
+
+		const int32 LeastRecent = PlayTemplate(Bookkeeping, Busy, TemplateA, 2, bStolen);
+		PlayTemplate(Bookkeeping, Busy, TemplateB, 2, bStolen);
+
+		TestEqual(TEXT("Least recently used component is stolen"), PlayTemplate(Bookkeeping, Busy, TemplateC, 2, bStolen), LeastRecent);
+		TestTrue(TEXT("Busy component of another template is stolen"), bStolen);
+		TestEqual(TEXT("Pool stays within its cap"), Bookkeeping.Num(), 2);
+	}
+
+	// A cap below one still pools a single component
+	for (const int32 MaxComponents : { 0, -1 })
+	{
+		FBSEffectPoolBookkeeping Bookkeeping;
+		TArray<bool> Busy;
+
+		PlayTemplate(Bookkeeping, Busy, TemplateA, MaxComponents, bStolen);
+		TestEqual(FString::Printf(TEXT("Cap of %d adds one component"), MaxComponents), Bookkeeping.Num(), 1);
+
+		TestEqual(FString::Printf(TEXT("Cap of %d steals the only component"), MaxComponents), PlayTemplate(Bookkeeping, Busy, TemplateB, MaxComponents, bStolen), 0);
+		TestTrue(FString::Printf(TEXT("Cap of %d reports the steal"), MaxComponents), bStolen);
+		TestEqual(FString::Printf(TEXT("Cap of %d never grows the pool"), MaxComponents), Bookkeeping.Num(), 1);
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
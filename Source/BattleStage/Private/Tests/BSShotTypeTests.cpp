@@ -0,0 +1,129 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BattleStage.h"
+#include "BSShotType.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/** Writes a hit record and reads it back. Returns the result of writing. */
+static bool RoundTripHitRecord(const FShotHitRecord& Record, const FVector& Origin, FShotHitRecord& OutRecord)
+{
+	FShotHitRecord WriteRecord = Record;
+
+	FBitWriter Writer(256, true);
+	const bool bWriteInRange = WriteRecord.SerializeImpact(Writer, Origin);
+
+	FBitReader Reader(Writer.GetData(), Writer.GetNumBits());
+	OutRecord.SerializeImpact(Reader, Origin);
+
+	return bWriteInRange && !Writer.IsError() && !Reader.IsError();
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FShotHitRecordRoundTripTest, "BattleStage.Weapons.ShotHitRecord.RoundTrip", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FShotHitRecordRoundTripTest::RunTest(const FString& Parameters)
+{
+	const FVector Origin(1234.5f, -678.9f, 42.f);
+
+	// Bone index, including INDEX_NONE and indices that need more than one packed byte
+	for (const int32 BoneIndex : { INDEX_NONE, 0, 1, 126, 127, 128, 16000 })
+	{
+		FShotHitRecord Record;
+		Record.BoneIndex = BoneIndex;
+		Record.ImpactPoint = Origin;
+
+		FShotHitRecord Result;
+		TestTrue(TEXT("Bone index record serializes"), RoundTripHitRecord(Record, Origin, Result));
+		TestEqual(FString::Printf(TEXT("Bone index %d round trips"), BoneIndex), Result.BoneIndex, BoneIndex);
+	}
+
+	// Surface type, every value fits in the packed range
+	for (int32 Surface = 0; Surface < SurfaceType_Max; ++Surface)
+	{
+		FShotHitRecord Record;
+		Record.SurfaceType = static_cast<EPhysicalSurface>(Surface);
+		Record.ImpactPoint = Origin;
+
+		FShotHitRecord Result;
+		RoundTripHitRecord(Record, Origin, Result);
+		TestEqual(FString::Printf(TEXT("Surface type %d round trips"), Surface), static_cast<int32>(Result.SurfaceType.GetValue()), Surface);
+	}
+
+	// Impact offsets are quantized to tenths of a unit
+	const FVector Offsets[] =
+	{
+		FVector::ZeroVector,
+		FVector(0.04f, -0.04f, 0.05f),
+		FVector(10000.f, -10000.f, 5000.05f),
+		FVector(100000.f, -100000.f, 100000.f), // Near the 20 bit limit
+	};
+
+	for (const FVector& Offset : Offsets)
+	{
+		FShotHitRecord Record;
+		Record.ImpactPoint = Origin + Offset;
+
+		FShotHitRecord Result;
+		TestTrue(FString::Printf(TEXT("Offset %s is in range"), *Offset.ToString()), RoundTripHitRecord(Record, Origin, Result));
+		TestTrue(FString::Printf(TEXT("Offset %s round trips within quantization"), *Offset.ToString()), Result.ImpactPoint.Equals(Record.ImpactPoint, 0.051f));
+	}
+
+	// Offsets past the quantization range are clamped and reported
+	{
+		FShotHitRecord Record;
+		Record.ImpactPoint = Origin + FVector(200000.f, 0.f, 0.f);
+
+		FShotHitRecord Result;
+		TestFalse(TEXT("Offset past the quantization range is reported"), RoundTripHitRecord(Record, Origin, Result));
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FShotBatchRoundTripTest, "BattleStage.Weapons.ShotBatch.RoundTrip", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FShotBatchRoundTripTest::RunTest(const FString& Parameters)
+{
+	FShotBatch Batch;
+	Batch.MoveTimeStamp = 12.5f;
+
+	const float ShotTimes[] = { 100.25f, 100.3f, 100.4f };
+	for (const float ShotTime : ShotTimes)
+	{
+		FShotData ShotData;
+		ShotData.ShotIndex = Batch.Num();
+		Batch.Add(ShotData, ShotTime);
+	}
+
+	bool bWriteSuccess = false;
+
+	FBitWriter Writer(1024, true);
+	Batch.NetSerialize(Writer, nullptr, bWriteSuccess);
+
+	// Saving leaves the sender's shot times untouched
+	for (int32 i = 0; i < Batch.Num(); ++i)
+	{
+		TestEqual(FString::Printf(TEXT("Shot time %d is unchanged by saving"), i), Batch.ShotTimes[i], ShotTimes[i]);
+	}
+
+	FShotBatch Result;
+	bool bReadSuccess = false;
+
+	FBitReader Reader(Writer.GetData(), Writer.GetNumBits());
+	Result.NetSerialize(Reader, nullptr, bReadSuccess);
+
+	TestTrue(TEXT("Shot batch serializes"), bWriteSuccess && bReadSuccess && !Writer.IsError() && !Reader.IsError());
+	TestEqual(TEXT("Shot count round trips"), Result.Num(), Batch.Num());
+	TestEqual(TEXT("Move timestamp round trips"), Result.MoveTimeStamp, Batch.MoveTimeStamp);
+
+	// Loading reads times as offsets from the first shot, in milliseconds
+	for (int32 i = 0; i < Result.Num(); ++i)
+	{
+		TestTrue(FString::Printf(TEXT("Shot time %d is read as an offset"), i), FMath::IsNearlyEqual(Result.ShotTimes[i], ShotTimes[i] - ShotTimes[0], 0.0011f));
+		TestEqual(FString::Printf(TEXT("Shot %d round trips in order"), i), static_cast<int32>(Result.Shots[i].ShotIndex), i);
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
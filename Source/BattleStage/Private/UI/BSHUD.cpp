@@ -12,15 +12,19 @@
 
 #define LOCTEXT_NAMESPACE "BattleStage.HUD"
 
+// Lowest opacity scale of hit and damage indicators, so light hits stay visible
+static const float MIN_INDICATOR_DAMAGE_SCALE = 0.35f;
+
 ABSHUD::ABSHUD(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 {
 	LastWeaponHitTime = LastDamagedTime = -MAX_FLT;
 }
 
-void ABSHUD::NotifyWeaponHit()
+void ABSHUD::NotifyWeaponHit(const int32 Damage)
 {
 	LastWeaponHitTime = GetWorld()->GetTimeSeconds();
+	LastWeaponHitDamage = Damage;
 
 	if (HitIndicatorSound)
 	{
@@ -30,9 +34,28 @@ void ABSHUD::NotifyWeaponHit()
 	OnNotifyWeaponHit.Broadcast();
 }
 
-void ABSHUD::NotifyReceivedDamage(const FVector& InDamageOrigin)
+void ABSHUD::NotifyPredictedHit(ABSWeapon* Weapon, const uint16 ShotIndex)
+{
+	FPredictedHit PredictedHit;
+	PredictedHit.Weapon = Weapon;
+	PredictedHit.ShotIndex = ShotIndex;
+	PredictedHit.Time = GetWorld()->GetTimeSeconds();
+
+	PredictedHits.Add(PredictedHit);
+}
+
+void ABSHUD::NotifyShotResults(ABSWeapon* Weapon, const TArray<uint16>& ConfirmedShots, const TArray<uint16>& RejectedShots)
+{
+	PredictedHits.RemoveAll([&](const FPredictedHit& PredictedHit)
+	{
+		return PredictedHit.Weapon == Weapon && (ConfirmedShots.Contains(PredictedHit.ShotIndex) || RejectedShots.Contains(PredictedHit.ShotIndex));
+	});
+}
+
+void ABSHUD::NotifyReceivedDamage(const FVector& InDamageOrigin, const int32 Damage)
 {
 	LastDamagedTime = GetWorld()->GetTimeSeconds();
+	LastDamageReceived = Damage;
 
 	DamageOrigin = InDamageOrigin;
 
@@ -235,14 +258,32 @@ void ABSHUD::DrawCrosshair(ABSCharacter& Character)
 				CenterY - Crosshair[(uint8)ECrosshairPosition::Right].VL * UIScale / 2.f,
 				UIScale);
 
+			// Forget predicted hits the server never resolved
+			const float WorldTime = GetWorld()->GetTimeSeconds();
+			while (PredictedHits.Num() > 0 && WorldTime - PredictedHits[0].Time >= PredictedHitTimeout)
+			{
+				PredictedHits.RemoveAt(0, 1, false);
+			}
+
 			// Draw hit marker if within time of last hit
-			const float SinceLastHit = GetWorld()->GetTimeSeconds() - LastWeaponHitTime;
+			const float SinceLastHit = WorldTime - LastWeaponHitTime;
 			if (SinceLastHit < HitIndicationDuration)
 			{
-				// Scale alpha based on time since last hit
-				const float Alpha = 1.f - SinceLastHit / HitIndicationDuration;
+				// Scale alpha based on time since last hit and the damage it dealt
+				const float DamageScale = FMath::Clamp(LastWeaponHitDamage / HitIndicatorFullDamage, MIN_INDICATOR_DAMAGE_SCALE, 1.f);
+				const float Alpha = (1.f - SinceLastHit / HitIndicationDuration) * DamageScale;
 				Canvas->SetDrawColor(255, 52, 52, Alpha * 255);
 
+				Canvas->DrawIcon(HitIndicator,
+					CenterX - HitIndicator.UL * UIScale / 2.f,
+					CenterY - HitIndicator.VL * UIScale / 2.f,
+					UIScale);
+			}
+			else if (PredictedHits.Num() > 0)
+			{
+				// Provisional marker while the server validates the latest predicted hit
+				Canvas->SetDrawColor(PredictedHitColor);
+
 				Canvas->DrawIcon(HitIndicator,
 					CenterX - HitIndicator.UL * UIScale / 2.f,
 					CenterY - HitIndicator.VL * UIScale / 2.f,
@@ -286,7 +327,8 @@ void ABSHUD::DrawDamageIndicator()
 				DamageRotation = -DamageRotation;
 
 			// Draw indicator
-			const float Alpha = 1.f - (SinceLastDamage / DamageIndicatorDuration);
+			const float DamageScale = FMath::Clamp(LastDamageReceived / DamageIndicatorFullDamage, MIN_INDICATOR_DAMAGE_SCALE, 1.f);
+			const float Alpha = (1.f - (SinceLastDamage / DamageIndicatorDuration)) * DamageScale;
 			const FLinearColor TextureColor{ 1, 1, 1, Alpha };
 
 			float CenterX = 0.f, CenterY = 0.f;
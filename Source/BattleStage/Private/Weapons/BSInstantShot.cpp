@@ -5,9 +5,49 @@
 #include "BSInstantShot.h"
 #include "BSWeapon.h"
 #include "BSImpactEffect.h"
+#include "BSLagCompensation.h"
+#include "BSEffectsLOD.h"
+
+#include "PhysicalMaterials/PhysicalMaterial.h"
 
 static const float MAX_SHOT_RANGE = 10000.f;
 
+static TAutoConsoleVariable<int32> CVarCosmeticTraceBudget(
+	TEXT("bs.CosmeticTraceBudget"),
+	16,
+	TEXT("Max async traces issued per frame to simulate remote instant shots. Shots over budget use their replicated target."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarCosmeticTraceDistance(
+	TEXT("bs.CosmeticTraceDistance"),
+	5000.f,
+	TEXT("Remote instant shots further than this from the local view use their replicated target instead of tracing."),
+	ECVF_Default);
+
+/**
+* Consumes one cosmetic trace from the per frame budget shared by all instant shots.
+* @returns True if the trace is within budget.
+*/
+static bool ConsumeCosmeticTraceBudget()
+{
+	static uint64 BudgetFrame = 0;
+	static int32 TracesThisFrame = 0;
+
+	if (BudgetFrame != GFrameCounter)
+	{
+		BudgetFrame = GFrameCounter;
+		TracesThisFrame = 0;
+	}
+
+	if (TracesThisFrame >= CVarCosmeticTraceBudget.GetValueOnGameThread())
+	{
+		return false;
+	}
+
+	++TracesThisFrame;
+	return true;
+}
+
 void UBSInstantShot::GetLifetimeReplicatedProps(TArray<class FLifetimeProperty> & OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
@@ -19,20 +59,20 @@ bool UBSInstantShot::GetShotData(FShotData& OutShotData) const
 {
 	const ABSWeapon* const Weapon = GetWeapon();
 	OutShotData.Start = Weapon->GetAimLocation();
-
-	// Get a random weapon spread for the shot
-	const int32 RandomSeed = FMath::Rand();
-	FRandomStream SpreadStream(RandomSeed);
-	const float BaseSpread = FMath::DegreesToRadians(Weapon->GetCurrentSpread());
+	OutShotData.Spread = Weapon->GetCurrentSpread();
 
 	// Use spread to offset shot
-	const FVector TrueAimDirection = Weapon->GetAimRotation().Vector();
-	OutShotData.Direction = SpreadStream.VRandCone(TrueAimDirection, BaseSpread);
+	Weapon->ApplyShotSpread(OutShotData);
 
 	const FVector FireEnd = OutShotData.Start + OutShotData.Direction * MAX_SHOT_RANGE;
 
-	OutShotData.Impact = WeaponTrace(OutShotData.Start, FireEnd);
-	OutShotData.bImpactNeeded = OutShotData.Impact.bBlockingHit ? true : false;
+	const FHitResult Impact = WeaponTrace(OutShotData.Start, FireEnd);
+	OutShotData.bImpactNeeded = Impact.bBlockingHit ? true : false;
+
+	if (OutShotData.bImpactNeeded)
+	{
+		OutShotData.Impact = FShotHitRecord(Impact);
+	}
 
 	return true;
 }
@@ -43,8 +83,25 @@ void UBSInstantShot::PreInvokeShot(const FShotData& ShotData)
 	const ABSWeapon* const Weapon = GetWeapon();
 	if (!Weapon->HasAuthority())
 	{
-		const FVector Target = ShotData.Start + ShotData.Direction * MAX_SHOT_RANGE;
-		SimulateFire(Target);
+		// GetShotData already traced the shot, play its impact straight away so the shooter sees no delay
+		if (!ShotData.bImpactNeeded)
+		{
+			PlayTrailEffects(ShotData.Start + ShotData.Direction * MAX_SHOT_RANGE);
+			return;
+		}
+
+		PlayImpactEffects(ShotData.Impact.ToHitResult(ShotData.Start, ShotData.Direction), ShotData.Impact.SurfaceType);
+		PlayTrailEffects(ShotData.Impact.ImpactPoint);
+
+		// Mark character hits straight away, the server confirms or rejects them with its damage feedback
+		const ABSCharacter* const HitCharacter = Cast<ABSCharacter>(ShotData.Impact.Actor.Get());
+		if (HitCharacter && HitCharacter->GetHealth() > 0)
+		{
+			if (ABSPlayerController* const PlayerController = Cast<ABSPlayerController>(Weapon->GetInstigatorController()))
+			{
+				PlayerController->NotifyPredictedHit(GetWeapon(), ShotData.ShotIndex);
+			}
+		}
 	}
 }
 
@@ -69,6 +126,20 @@ void UBSInstantShot::PlayTrailEffects(const FVector& End) const
 		const FVector Start = Weapon->GetFireLocation();
 		const FVector DirectionVector = (End - Start);
 
+		// The shooter always sees its own tracers
+		const ABSCharacter* const Character = Weapon->GetCharacter();
+		if (!Character || !Character->IsLocallyControlled())
+		{
+			FVector ViewLocation;
+			if (!FBSEffectsLOD::GetViewLocation(GetWorld(), ViewLocation) || !FBSEffectsLOD::IsTracerRelevant(ViewLocation, Start, End))
+			{
+				INC_DWORD_STAT(STAT_BSTracersCulled);
+				return;
+			}
+		}
+
+		INC_DWORD_STAT(STAT_BSTracersPlayed);
+
 		UParticleSystemComponent* TrailComponent = UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), TrailFX, Start, DirectionVector.GetUnsafeNormal().Rotation());
 		if (TrailEndParam != NAME_None)
 		{
@@ -78,11 +149,25 @@ void UBSInstantShot::PlayTrailEffects(const FVector& End) const
 }
 
 void UBSInstantShot::PlayImpactEffects(const FHitResult& Hit) const
+{
+	PlayImpactEffects(Hit, UPhysicalMaterial::DetermineSurfaceType(Hit.PhysMaterial.Get()));
+}
+
+void UBSInstantShot::PlayImpactEffects(const FHitResult& Hit, const EPhysicalSurface SurfaceType) const
 {
 	if (ImpactEffect)
 	{
 		const UBSImpactEffect* const EffectObject = ImpactEffect->GetDefaultObject<UBSImpactEffect>();
-		EffectObject->SpawnEffect(GetWorld(), Hit);
+		EffectObject->SpawnEffectForSurface(GetWorld(), Hit, SurfaceType);
+	}
+}
+
+void UBSInstantShot::PlayImpactEffects(const TArray<FHitResult>& Hits) const
+{
+	if (ImpactEffect && Hits.Num() > 0)
+	{
+		const UBSImpactEffect* const EffectObject = ImpactEffect->GetDefaultObject<UBSImpactEffect>();
+		EffectObject->SpawnEffects(GetWorld(), Hits);
 	}
 }
 
@@ -98,37 +183,95 @@ void UBSInstantShot::RespondValidatedShot(const FShotData& ShotData)
 			AActor& HitActor = *ShotData.Impact.Actor;
 
 			const float BaseDamage = Weapon->GetWeaponStats().BaseDamage;
-			const FPointDamageEvent DamageEvent(BaseDamage, ShotData.Impact, -ShotData.Direction, DamageType);
+			const FHitResult Hit = ShotData.Impact.ToHitResult(ShotData.Start, ShotData.Direction);
+			const FPointDamageEvent DamageEvent(BaseDamage, Hit, -ShotData.Direction, DamageType);
 
 			HitActor.TakeDamage(BaseDamage, DamageEvent, Weapon->GetInstigatorController(), Weapon->GetCharacter());
 		}
 
-		// Simulate on remotes
-		ShotRep.Target = ShotEnd;
-		ShotRep.FireToggle = !ShotRep.FireToggle;
+		SimulateOnRemotes(ShotEnd);
 	}
 
 	// Play local effects
 	if (Weapon->GetNetMode() != NM_DedicatedServer)
 	{
-		if (ShotData.Impact.bBlockingHit)
-			PlayImpactEffects(ShotData.Impact);
+		if (ShotData.bImpactNeeded)
+			PlayImpactEffects(ShotData.Impact.ToHitResult(ShotData.Start, ShotData.Direction), ShotData.Impact.SurfaceType);
 
 		PlayTrailEffects(ShotEnd);
 	}
 }
 
-void UBSInstantShot::SimulateFire(const FVector& Target) const
+void UBSInstantShot::SimulateOnRemotes(const FVector& Target, const uint16 Seed)
 {
-	ABSWeapon* const Weapon = GetWeapon();
+	ShotRep.AddShot(Target, Seed);
+}
 
-	const FVector AimStart = Weapon->GetAimLocation();
+void UBSInstantShot::SimulateShotRep(const FInstantShotRep& Shot)
+{
+	SimulateFire(Shot.Target);
+}
+
+void UBSInstantShot::SimulateFire(const FVector& Target) const
+{
+	const FVector AimStart = GetWeapon()->GetAimLocation();
 
 	// Trace in target direction to prevent missing the target by small amounts when simulating a 
 	// replicated shot that hit a target.
 	const FVector TraceEnd = AimStart + (Target - AimStart).GetSafeNormal() * MAX_SHOT_RANGE;
-	const FHitResult Impact = WeaponTrace(AimStart, TraceEnd);
 
+	SimulateTrace(AimStart, TraceEnd, Target);
+}
+
+void UBSInstantShot::SimulateTrace(const FVector& Start, const FVector& End, const FVector& Fallback) const
+{
+	if (!IsCosmeticTraceRelevant(Start, Fallback) || !ConsumeCosmeticTraceBudget())
+	{
+		// Not worth a trace, end the shot at the fallback
+		PlayTrailEffects(Fallback);
+		return;
+	}
+
+	const ABSWeapon* const Weapon = GetWeapon();
+
+	FCollisionQueryParams QueryParams(NAME_None, false, Weapon);
+	QueryParams.bReturnPhysicalMaterial = true;
+
+	FTraceDelegate TraceDelegate = FTraceDelegate::CreateUObject(this, &UBSInstantShot::OnCosmeticTraceDone);
+	GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Single, Start, End, WEAPON_CHANNEL, QueryParams, FCollisionResponseParams::DefaultResponseParam, &TraceDelegate);
+}
+
+bool UBSInstantShot::IsCosmeticTraceRelevant(const FVector& Start, const FVector& End) const
+{
+	FVector ViewLocation;
+	if (!FBSEffectsLOD::GetViewLocation(GetWorld(), ViewLocation))
+	{
+		return false;
+	}
+
+	const float MaxDistance = CVarCosmeticTraceDistance.GetValueOnGameThread();
+	return FMath::PointDistToSegmentSquared(ViewLocation, Start, End) <= FMath::Square(MaxDistance);
+}
+
+void UBSInstantShot::OnCosmeticTraceDone(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum) const
+{
+	// The weapon may have been unequipped or destroyed while the trace was in flight
+	const ABSWeapon* const Weapon = GetWeapon();
+	if (!Weapon || Weapon->IsPendingKill() || !Weapon->GetCharacter())
+		return;
+
+	if (TraceDatum.OutHits.Num() > 0)
+	{
+		PlayShotEffects(TraceDatum.OutHits[0]);
+	}
+	else
+	{
+		PlayTrailEffects(TraceDatum.End);
+	}
+}
+
+void UBSInstantShot::PlayShotEffects(const FHitResult& Impact) const
+{
 	if (Impact.bBlockingHit)
 		PlayImpactEffects(Impact);
 
@@ -150,13 +293,103 @@ FHitResult UBSInstantShot::WeaponTrace(const FVector& Start, const FVector& End)
 
 void UBSInstantShot::OnRep_ShotRep()
 {
-	SimulateFire(ShotRep.Target);
+	// Gather shots that haven't been simulated yet. The fast array doesn't keep
+	// the server's order, so sort them by sequence.
+	TArray<const FInstantShotRep*, TInlineAllocator<MAX_REPLICATED_SHOTS>> NewShots;
+
+	for (const FInstantShotRep& Shot : ShotRep.Shots)
+	{
+		if (!bReceivedShotRep || static_cast<int16>(Shot.Sequence - LastSimulatedSequence) > 0)
+		{
+			NewShots.Add(&Shot);
+		}
+	}
+
+	if (NewShots.Num() == 0)
+		return;
+
+	const uint16 BaseSequence = bReceivedShotRep ? LastSimulatedSequence : NewShots[0]->Sequence;
+	NewShots.Sort([BaseSequence](const FInstantShotRep& A, const FInstantShotRep& B)
+	{
+		return static_cast<int16>(A.Sequence - BaseSequence) < static_cast<int16>(B.Sequence - BaseSequence);
+	});
+
+	if (bReceivedShotRep)
+	{
+		for (const FInstantShotRep* const Shot : NewShots)
+		{
+			SimulateShotRep(*Shot);
+		}
+	}
+
+	LastSimulatedSequence = NewShots.Last()->Sequence;
+	bReceivedShotRep = true;
 }
 
 void UBSInstantShot::ProcessHit(const FShotData& ShotData)
 {
-	// #bstodo Will need to verify a valid hit on the server
-	RespondValidatedShot(ShotData);
+	const bool bValidHit = ValidateHit(ShotData);
+
+	NotifyHitResult(ShotData, bValidHit);
+
+	if (bValidHit)
+	{
+		RespondValidatedShot(ShotData);
+	}
+	else
+	{
+		// Treat rejected hits as misses so remotes still see the shot
+		FShotData MissData = ShotData;
+		MissData.Impact = FShotHitRecord();
+		MissData.bImpactNeeded = false;
+
+		ProcessMiss(MissData);
+	}
+}
+
+bool UBSInstantShot::ValidateHit(const FShotData& ShotData) const
+{
+	const ABSWeapon* const Weapon = GetWeapon();
+
+	ABSCharacter* const HitCharacter = Cast<ABSCharacter>(ShotData.Impact.Actor.Get());
+	if (!HitCharacter || Weapon->GetNetMode() == NM_Standalone)
+	{
+		// Only character hits affect gameplay enough to need validation
+		return true;
+	}
+
+	// Rewind the hit character to the time the shooter saw it and re-trace the shot against it
+	const float RewindTime = GetRewindTime(ShotData);
+	const FVector TraceEnd = ShotData.Start + ShotData.Direction * MAX_SHOT_RANGE;
+
+	FVector RewoundImpact;
+	if (!FBSLagCompensation::RewindTraceCharacter(*HitCharacter, ShotData.Start, TraceEnd, RewindTime, RewoundImpact))
+	{
+		UE_LOG(BattleStage, Verbose, TEXT("UBSInstantShot rejected hit on %s. Shot missed the rewound hitbox."), *HitCharacter->GetName());
+		return false;
+	}
+
+	if (FBSLagCompensation::IsOccluded(GetWorld(), ShotData.Start, RewoundImpact, Weapon->GetCharacter()))
+	{
+		UE_LOG(BattleStage, Verbose, TEXT("UBSInstantShot rejected hit on %s. Shot was blocked by world geometry."), *HitCharacter->GetName());
+		return false;
+	}
+
+	return true;
+}
+
+void UBSInstantShot::NotifyHitResult(const FShotData& ShotData, const bool bConfirmed) const
+{
+	if (!Cast<ABSCharacter>(ShotData.Impact.Actor.Get()))
+		return;
+
+	// Only remote shooters predicted a hit marker that needs resolving
+	ABSWeapon* const Weapon = GetWeapon();
+	ABSPlayerController* const PlayerController = Cast<ABSPlayerController>(Weapon->GetInstigatorController());
+	if (PlayerController && !PlayerController->IsLocalController())
+	{
+		PlayerController->NotifyShotResult(Weapon, ShotData.ShotIndex, bConfirmed);
+	}
 }
 
 void UBSInstantShot::ProcessMiss(const FShotData& ShotData)
@@ -0,0 +1,196 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BattleStage.h"
+
+#include "BSPelletShot.h"
+#include "BSWeapon.h"
+#include "BSLagCompensation.h"
+
+UBSPelletShot::UBSPelletShot(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	PelletTraceDelegate.BindUObject(this, &UBSPelletShot::OnPelletTraceDone);
+}
+
+bool UBSPelletShot::GetShotData(FShotData& OutShotData) const
+{
+	const ABSWeapon* const Weapon = GetWeapon();
+	OutShotData.Start = Weapon->GetAimLocation();
+	OutShotData.Spread = Weapon->GetCurrentSpread();
+
+	// Use spread to offset the center of the pellet cone
+	Weapon->ApplyShotSpread(OutShotData);
+
+	// The server traces the pellets itself, so no impact is sent
+	OutShotData.bImpactNeeded = false;
+
+	return true;
+}
+
+void UBSPelletShot::PreInvokeShot(const FShotData& ShotData)
+{
+	SimulatePellets(ShotData.Start, ShotData.Direction, GetPelletSeed(ShotData), false);
+}
+
+void UBSPelletShot::InvokeShot(const FShotData& ShotData)
+{
+	ABSWeapon* const Weapon = GetWeapon();
+
+	if (PendingShots.Contains(ShotData.ShotIndex))
+	{
+		UE_LOG(BattleStage, Warning, TEXT("UBSPelletShot ignoring shot %d. Previous shot with the same index is still pending."), ShotData.ShotIndex);
+		return;
+	}
+
+	FPendingPelletShot& PendingShot = PendingShots.Add(ShotData.ShotIndex);
+	PendingShot.ShotData = ShotData;
+	PendingShot.RewindTime = GetRewindTime(ShotData);
+
+	const uint16 PelletSeed = GetPelletSeed(ShotData);
+	GetPelletDirections(ShotData.Direction, PelletSeed, PendingShot.Directions);
+
+	PendingShot.BlockDistances.Init(PelletRange, PendingShot.Directions.Num());
+	PendingShot.RemainingTraces = PendingShot.Directions.Num();
+
+	// Only static geometry is traced since characters are resolved against their rewound hitboxes
+	static const FName PelletTraceTag(TEXT("PelletTrace"));
+	const FCollisionQueryParams QueryParams(PelletTraceTag, false, Weapon->GetCharacter());
+	const FCollisionObjectQueryParams ObjectParams(ECC_WorldStatic);
+
+	for (int32 i = 0; i < PendingShot.Directions.Num(); ++i)
+	{
+		const FVector End = ShotData.Start + PendingShot.Directions[i] * PelletRange;
+		const uint32 UserData = (static_cast<uint32>(ShotData.ShotIndex) << 8) | static_cast<uint32>(i);
+
+		GetWorld()->AsyncLineTraceByObjectType(EAsyncTraceType::Single, ShotData.Start, End, ObjectParams, QueryParams, &PelletTraceDelegate, UserData);
+	}
+
+	// Simulate on remotes
+	SimulateOnRemotes(ShotData.Start + ShotData.Direction * PelletRange, PelletSeed);
+
+	// The shooter already simulated the shot in PreInvokeShot
+	const ABSCharacter* const Character = Weapon->GetCharacter();
+	if (Weapon->GetNetMode() != NM_DedicatedServer && Character && !Character->IsLocallyControlled())
+	{
+		SimulatePellets(Weapon->GetAimLocation(), ShotData.Direction, PelletSeed, true);
+	}
+}
+
+uint16 UBSPelletShot::GetPelletSeed(const FShotData& ShotData) const
+{
+	// Draw from the shot's stream so pellets aren't correlated with the shot's own spread
+	FRandomStream ShotStream = GetWeapon()->GetShotRandomStream(ShotData.ShotIndex);
+	return static_cast<uint16>(ShotStream.GetUnsignedInt());
+}
+
+void UBSPelletShot::GetPelletDirections(const FVector& Direction, const uint16 PelletSeed, TArray<FVector>& OutDirections) const
+{
+	FRandomStream PelletStream(PelletSeed);
+	const float SpreadRadians = FMath::DegreesToRadians(PelletSpread);
+
+	OutDirections.Reset(PelletCount);
+
+	for (int32 i = 0; i < PelletCount; ++i)
+	{
+		OutDirections.Add(PelletStream.VRandCone(Direction, SpreadRadians));
+	}
+}
+
+void UBSPelletShot::SimulatePellets(const FVector& Start, const FVector& Direction, const uint16 PelletSeed, const bool bAsync) const
+{
+	TArray<FVector> Directions;
+	GetPelletDirections(Direction, PelletSeed, Directions);
+
+	for (const FVector& PelletDirection : Directions)
+	{
+		const FVector End = Start + PelletDirection * PelletRange;
+
+		if (bAsync)
+		{
+			SimulateTrace(Start, End, End);
+		}
+		else
+		{
+			PlayShotEffects(WeaponTrace(Start, End));
+		}
+	}
+}
+
+void UBSPelletShot::SimulateShotRep(const FInstantShotRep& Shot)
+{
+	const FVector AimStart = GetWeapon()->GetAimLocation();
+	SimulatePellets(AimStart, (Shot.Target - AimStart).GetSafeNormal(), Shot.Seed, true);
+}
+
+void UBSPelletShot::OnPelletTraceDone(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum)
+{
+	const uint16 ShotIndex = static_cast<uint16>(TraceDatum.UserData >> 8);
+	const int32 PelletIndex = static_cast<int32>(TraceDatum.UserData & 0xFF);
+
+	FPendingPelletShot* const PendingShot = PendingShots.Find(ShotIndex);
+	if (!PendingShot || !PendingShot->BlockDistances.IsValidIndex(PelletIndex))
+		return;
+
+	if (TraceDatum.OutHits.Num() > 0 && TraceDatum.OutHits[0].bBlockingHit)
+	{
+		PendingShot->BlockDistances[PelletIndex] = TraceDatum.OutHits[0].Distance;
+	}
+
+	if (--PendingShot->RemainingTraces == 0)
+	{
+		ResolvePellets(ShotIndex);
+	}
+}
+
+void UBSPelletShot::ResolvePellets(const uint16 ShotIndex)
+{
+	FPendingPelletShot PendingShot;
+	if (!PendingShots.RemoveAndCopyValue(ShotIndex, PendingShot))
+		return;
+
+	ABSWeapon* const Weapon = GetWeapon();
+	const FShotData& ShotData = PendingShot.ShotData;
+	const float PelletDamage = Weapon->GetWeaponStats().BaseDamage;
+
+	struct FVictimDamage
+	{
+		float Damage = 0.f;
+		FShotHitRecord FirstHit;
+		FVector Direction = FVector::ZeroVector;
+	};
+
+	TMap<ABSCharacter*, FVictimDamage> Victims;
+	TArray<FBSLagCompensation::FRewoundHit> Hits;
+
+	for (int32 i = 0; i < PendingShot.Directions.Num(); ++i)
+	{
+		const FVector End = ShotData.Start + PendingShot.Directions[i] * PendingShot.BlockDistances[i];
+
+		Hits.Reset();
+		FBSLagCompensation::RewindTraceMulti(GetWorld(), ShotData.Start, End, PendingShot.RewindTime, Weapon->GetCharacter(), Hits);
+
+		if (Hits.Num() > 0)
+		{
+			const FBSLagCompensation::FRewoundHit& Hit = Hits[0];
+
+			FVictimDamage* Victim = Victims.Find(Hit.Character);
+			if (!Victim)
+			{
+				Victim = &Victims.Add(Hit.Character);
+				Victim->FirstHit.Actor = Hit.Character;
+				Victim->FirstHit.ImpactPoint = Hit.Location;
+				Victim->Direction = PendingShot.Directions[i];
+			}
+
+			Victim->Damage += PelletDamage;
+		}
+	}
+
+	for (const auto& Victim : Victims)
+	{
+		const FHitResult Hit = Victim.Value.FirstHit.ToHitResult(ShotData.Start, Victim.Value.Direction);
+		const FPointDamageEvent DamageEvent(Victim.Value.Damage, Hit, -Victim.Value.Direction, DamageType);
+
+		Victim.Key->TakeDamage(Victim.Value.Damage, DamageEvent, Weapon->GetInstigatorController(), Weapon->GetCharacter());
+	}
+}
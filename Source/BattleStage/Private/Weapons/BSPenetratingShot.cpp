@@ -0,0 +1,183 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BattleStage.h"
+
+#include "BSPenetratingShot.h"
+#include "BSWeapon.h"
+#include "BSLagCompensation.h"
+
+#include "PhysicalMaterials/PhysicalMaterial.h"
+
+UBSPenetratingShot::UBSPenetratingShot(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	for (float& Scale : SurfacePenetrationScale)
+	{
+		Scale = 0.5f;
+	}
+}
+
+bool UBSPenetratingShot::GetShotData(FShotData& OutShotData) const
+{
+	const ABSWeapon* const Weapon = GetWeapon();
+	OutShotData.Start = Weapon->GetAimLocation();
+	OutShotData.Spread = Weapon->GetCurrentSpread();
+
+	// Use spread to offset shot
+	Weapon->ApplyShotSpread(OutShotData);
+
+	// The server traces the shot itself, so no impact is sent
+	OutShotData.bImpactNeeded = false;
+
+	return true;
+}
+
+void UBSPenetratingShot::PreInvokeShot(const FShotData& ShotData)
+{
+	SimulatePenetration(ShotData.Start, ShotData.Start + ShotData.Direction * ShotRange);
+}
+
+void UBSPenetratingShot::InvokeShot(const FShotData& ShotData)
+{
+	ABSWeapon* const Weapon = GetWeapon();
+	ABSCharacter* const Shooter = Weapon->GetCharacter();
+	const FVector TraceEnd = ShotData.Start + ShotData.Direction * ShotRange;
+
+	// Characters are resolved against their rewound hitboxes, so skip their current positions
+	TArray<FHitResult> SurfaceHits;
+	PenetrationTrace(ShotData.Start, TraceEnd, SurfaceHits);
+	SurfaceHits.RemoveAll([](const FHitResult& Hit) { return Cast<ABSCharacter>(Hit.GetActor()) != nullptr; });
+
+	TArray<FBSLagCompensation::FRewoundHit> CharacterHits;
+	FBSLagCompensation::RewindTraceMulti(GetWorld(), ShotData.Start, TraceEnd, GetRewindTime(ShotData), Shooter, CharacterHits);
+
+	struct FVictimDamage
+	{
+		float Damage = 0.f;
+		FHitResult Hit;
+	};
+
+	TMap<AActor*, FVictimDamage> Victims;
+
+	float Damage = Weapon->GetWeaponStats().BaseDamage;
+	int32 Penetrations = 0;
+	FVector ShotEnd = TraceEnd;
+
+	// Walk surfaces and characters in order of distance, reducing damage through each
+	int32 SurfaceIndex = 0;
+	int32 CharacterIndex = 0;
+
+	while (SurfaceIndex < SurfaceHits.Num() || CharacterIndex < CharacterHits.Num())
+	{
+		const bool bNextIsCharacter = CharacterIndex < CharacterHits.Num() &&
+			(SurfaceIndex == SurfaceHits.Num() || CharacterHits[CharacterIndex].Distance < SurfaceHits[SurfaceIndex].Distance);
+
+		FHitResult Hit;
+		float PenetrationScale = 1.f;
+
+		if (bNextIsCharacter)
+		{
+			const FBSLagCompensation::FRewoundHit& CharacterHit = CharacterHits[CharacterIndex++];
+
+			FShotHitRecord HitRecord;
+			HitRecord.Actor = CharacterHit.Character;
+			HitRecord.ImpactPoint = CharacterHit.Location;
+
+			Hit = HitRecord.ToHitResult(ShotData.Start, ShotData.Direction);
+			PenetrationScale = CharacterPenetrationScale;
+		}
+		else
+		{
+			Hit = SurfaceHits[SurfaceIndex++];
+			PenetrationScale = GetPenetrationScale(Hit);
+		}
+
+		if (AActor* const HitActor = Hit.GetActor())
+		{
+			FVictimDamage* Victim = Victims.Find(HitActor);
+			if (!Victim)
+			{
+				Victim = &Victims.Add(HitActor);
+				Victim->Hit = Hit;
+			}
+
+			Victim->Damage += Damage;
+		}
+
+		Damage *= PenetrationScale;
+
+		if (Damage < MinDamage || ++Penetrations > MaxPenetrations)
+		{
+			ShotEnd = Hit.ImpactPoint;
+			break;
+		}
+	}
+
+	for (const auto& Victim : Victims)
+	{
+		const FPointDamageEvent DamageEvent(Victim.Value.Damage, Victim.Value.Hit, -ShotData.Direction, DamageType);
+		Victim.Key->TakeDamage(Victim.Value.Damage, DamageEvent, Weapon->GetInstigatorController(), Shooter);
+	}
+
+	SimulateOnRemotes(ShotEnd);
+
+	// The shooter already simulated the shot in PreInvokeShot
+	if (Weapon->GetNetMode() != NM_DedicatedServer && Shooter && !Shooter->IsLocallyControlled())
+	{
+		SimulateFire(ShotEnd);
+	}
+}
+
+void UBSPenetratingShot::SimulateFire(const FVector& Target) const
+{
+	SimulatePenetration(GetWeapon()->GetAimLocation(), Target);
+}
+
+void UBSPenetratingShot::PenetrationTrace(const FVector& Start, const FVector& End, TArray<FHitResult>& OutHits) const
+{
+	static const FName PenetrationTraceTag(TEXT("PenetrationTrace"));
+
+	FCollisionQueryParams QueryParams(PenetrationTraceTag, false, GetWeapon());
+	QueryParams.AddIgnoredActor(GetWeapon()->GetCharacter());
+	QueryParams.bReturnPhysicalMaterial = true;
+
+	// Overlap everything the weapon channel would block so a single trace returns every surface
+	const FCollisionResponseParams ResponseParams(ECR_Overlap);
+
+	GetWorld()->LineTraceMultiByChannel(OutHits, Start, End, WEAPON_CHANNEL, QueryParams, ResponseParams);
+}
+
+void UBSPenetratingShot::SimulatePenetration(const FVector& Start, const FVector& End) const
+{
+	TArray<FHitResult> Hits;
+	PenetrationTrace(Start, End, Hits);
+
+	const float BaseDamage = GetWeapon()->GetWeaponStats().BaseDamage;
+	float Damage = BaseDamage;
+	FVector ShotEnd = End;
+
+	for (int32 i = 0; i < Hits.Num(); ++i)
+	{
+		const FHitResult& Hit = Hits[i];
+		const bool bHitCharacter = Cast<ABSCharacter>(Hit.GetActor()) != nullptr;
+
+		Damage *= bHitCharacter ? CharacterPenetrationScale : GetPenetrationScale(Hit);
+
+		if (Damage < MinDamage || i >= MaxPenetrations)
+		{
+			// Drop the surfaces the shot never reached
+			Hits.SetNum(i + 1);
+			ShotEnd = Hit.ImpactPoint;
+			break;
+		}
+	}
+
+	PlayImpactEffects(Hits);
+	PlayTrailEffects(ShotEnd);
+}
+
+float UBSPenetratingShot::GetPenetrationScale(const FHitResult& Hit) const
+{
+	const EPhysicalSurface SurfaceType = UPhysicalMaterial::DetermineSurfaceType(Hit.PhysMaterial.Get());
+	return SurfacePenetrationScale[static_cast<int32>(SurfaceType)];
+}
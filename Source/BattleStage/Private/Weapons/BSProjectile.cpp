@@ -6,12 +6,20 @@
 #include "GameFramework/ProjectileMovementComponent.h"
 
 #include "BSExplosion.h"
+#include "BSProjectileManager.h"
+#include "BSProjectileShot.h"
+#include "BSWeapon.h"
 
 ABSProjectile::ABSProjectile(const FObjectInitializer& ObjectInitializer /*= FObjectInitializer::Get()*/)
 	: Super(ObjectInitializer)
 {
-	bReplicates = true;
-	bReplicateMovement = true;
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+
+	// Never replicated as actors. ABSProjectileManager replicates launch data and detonations,
+	// and clients simulate their own replicas.
+	bReplicates = false;
+	bReplicateMovement = false;
 
 	// Use a sphere as a simple collision representation
 	CollisionComp = CreateDefaultSubobject<USphereComponent>(TEXT("SphereComp"));
@@ -35,10 +43,15 @@ ABSProjectile::ABSProjectile(const FObjectInitializer& ObjectInitializer /*= FOb
 	ProjectileMovement->ProjectileGravityScale = 0.0f;
 	ProjectileMovement->bRotationFollowsVelocity = true;
 
-	// Die after 3 seconds by default
-	InitialLifeSpan = 3.0f;
+	// Movement is simulated by ABSProjectileManager. The component only ticks when no manager is available.
+	ProjectileMovement->bAutoActivate = false;
 
 	bIsDetonated = false;
+	bIsPredicted = false;
+	bIsPooled = false;
+	bIsArmed = false;
+	bIsReplica = false;
+	bDetonateEffectsPlayed = false;
 }
 
 void ABSProjectile::PostInitializeComponents()
@@ -48,47 +61,286 @@ void ABSProjectile::PostInitializeComponents()
 
 	ProjectileMovement->OnProjectileStop.RemoveAll(this);
 	ProjectileMovement->OnProjectileStop.AddDynamic(this, &ABSProjectile::OnStop);
+}
+
+void ABSProjectile::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	StopSimulation();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ABSProjectile::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (!bIsPredicted)
+		return;
+
+	ABSProjectile* const Authoritative = ReconcileProjectile.Get();
+
+	if (Authoritative && Authoritative->IsArmed() && Authoritative->ReconcileProjectile.Get() == this)
+	{
+		// Chase the server's projectile, closing the remaining gap over the blend time
+		const float PrevAlpha = ReconcileAlpha;
+		ReconcileAlpha = FMath::Min(1.f, ReconcileAlpha + DeltaSeconds / FMath::Max(ReconcileBlendTime, KINDA_SMALL_NUMBER));
+
+		const float StepAlpha = (ReconcileAlpha - PrevAlpha) / (1.f - PrevAlpha);
+		SetActorLocationAndRotation(FMath::Lerp(GetActorLocation(), Authoritative->GetActorLocation(), StepAlpha), Authoritative->GetActorRotation());
+
+		if (ReconcileAlpha >= 1.f)
+		{
+			Authoritative->SetActorHiddenInGame(false);
+			Recycle();
+		}
+	}
+	else if (ReconcileAlpha > 0.f || GetWorld()->TimeSince(ArmTime) > MaxPredictionTime)
+	{
+		// The server's projectile was removed during the blend, or never spawned
+		Recycle();
+	}
+}
+
+void ABSProjectile::SetPredicted()
+{
+	bIsPredicted = true;
+}
+
+void ABSProjectile::Arm(const FTransform& SpawnTransform, AActor* NewOwner, APawn* NewInstigator, const uint16 NewShotIndex)
+{
+	SetOwner(NewOwner);
+	Instigator = NewInstigator;
 
 	// Make sure we don't hit the weapon or character firing
-	CollisionComp->IgnoreActorWhenMoving(GetOwner(), true);
-	CollisionComp->IgnoreActorWhenMoving(GetInstigator(), true);
+	CollisionComp->ClearMoveIgnoreActors();
+	CollisionComp->IgnoreActorWhenMoving(NewOwner, true);
+	CollisionComp->IgnoreActorWhenMoving(NewInstigator, true);
+
+	SetActorLocationAndRotation(SpawnTransform.GetLocation(), SpawnTransform.Rotator(), false, nullptr, ETeleportType::TeleportPhysics);
+
+	ShotIndex = NewShotIndex;
+	bIsArmed = true;
+	ArmTime = GetWorld()->GetTimeSeconds();
+
+	bIsDetonated = false;
+	bDetonateEffectsPlayed = false;
+	ReconcileProjectile.Reset();
+	ReconcileAlpha = 0.f;
+
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+
+	StartSimulation(SpawnTransform.GetRotation().Vector() * ProjectileMovement->InitialSpeed);
+
+	if (bIsPredicted)
+	{
+		// Tick to time out if the server's projectile never shows up
+		SetActorTickEnabled(true);
+	}
+
+	GetWorldTimerManager().SetTimer(RecycleTimer, this, &ABSProjectile::Recycle, LifeTime);
+
+	OnArmed();
+}
+
+void ABSProjectile::Disarm()
+{
+	GetWorldTimerManager().ClearAllTimersForObject(this);
+
+	StopSimulation();
+
+	SetActorEnableCollision(false);
+	SetActorHiddenInGame(true);
+	SetActorTickEnabled(false);
+
+	// Pooled projectiles are never destroyed, so the partner's link has to be cleared before
+	// this projectile is re-armed for another shot
+	if (ABSProjectile* const Partner = ReconcileProjectile.Get())
+	{
+		if (Partner->ReconcileProjectile.Get() == this)
+		{
+			Partner->ReconcileProjectile.Reset();
+		}
+	}
+
+	ReconcileProjectile.Reset();
+	ReconcileAlpha = 0.f;
+
+	bIsArmed = false;
+}
+
+void ABSProjectile::Recycle()
+{
+	ABSProjectileManager* const ProjectileManager = bIsPooled ? ABSProjectileManager::Get(GetWorld()) : nullptr;
+
+	if (ProjectileManager)
+	{
+		ProjectileManager->ReleaseProjectile(this);
+	}
+	else
+	{
+		Destroy();
+	}
+}
+
+void ABSProjectile::OnArmed()
+{
+
+}
+
+void ABSProjectile::StartSimulation(const FVector& Velocity)
+{
+	if (ABSProjectileManager* const ProjectileManager = ABSProjectileManager::Get(GetWorld()))
+	{
+		ProjectileManager->StartSimulating(this, Velocity);
+	}
+	else
+	{
+		ProjectileMovement->SetUpdatedComponent(CollisionComp);
+		ProjectileMovement->Velocity = Velocity;
+		ProjectileMovement->SetActive(true, true);
+		ProjectileMovement->UpdateComponentVelocity();
+	}
 }
 
-void ABSProjectile::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+void ABSProjectile::StopSimulation()
 {
-	DOREPLIFETIME(ABSProjectile, bIsDetonated);
+	if (SimIndex != INDEX_NONE)
+	{
+		if (ABSProjectileManager* const ProjectileManager = ABSProjectileManager::Get(GetWorld()))
+		{
+			ProjectileManager->StopSimulating(this);
+		}
+
+		SimIndex = INDEX_NONE;
+	}
+
+	ProjectileMovement->StopMovementImmediately();
+	ProjectileMovement->SetActive(false);
+}
+
+bool ABSProjectile::HandleSimulatedHit(const FHitResult& Hit, FVector& InOutVelocity)
+{
+	bool bKeepSimulating = false;
+
+	if (ProjectileMovement->bShouldBounce)
+	{
+		// Same response as UProjectileMovementComponent::ComputeBounceResult
+		const FVector Normal = Hit.Normal;
+		const float VDotNormal = InOutVelocity | Normal;
+
+		if (VDotNormal < 0.f)
+		{
+			const FVector Projected = -VDotNormal * Normal;
+			InOutVelocity += Projected * (1.f + ProjectileMovement->Bounciness);
+
+			const FVector Tangent = FVector::VectorPlaneProject(InOutVelocity, Normal);
+			InOutVelocity -= Tangent * FMath::Clamp(ProjectileMovement->Friction, 0.f, 1.f);
+		}
+
+		bKeepSimulating = InOutVelocity.SizeSquared() >= FMath::Square(ProjectileMovement->BounceVelocityStopSimulatingThreshold);
+	}
+
+	OnImpact(CollisionComp, Hit.GetActor(), Hit.GetComponent(), FVector::ZeroVector, Hit);
+
+	if (!bKeepSimulating)
+	{
+		OnStop(Hit);
+	}
+
+	return bKeepSimulating;
+}
+
+void ABSProjectile::BeginReconcile(ABSProjectile* AuthoritativeProjectile)
+{
+	check(bIsPredicted && AuthoritativeProjectile);
+
+	if (bIsDetonated)
+	{
+		// Already exploded locally, the server's projectile only needs to detonate silently
+		AuthoritativeProjectile->bDetonateEffectsPlayed = true;
+		AuthoritativeProjectile->SetActorHiddenInGame(true);
+		Recycle();
+		return;
+	}
+
+	// Stop simulating locally and follow the server's projectile
+	StopSimulation();
+	SetActorEnableCollision(false);
+
+	AuthoritativeProjectile->SetActorHiddenInGame(true);
+
+	AuthoritativeProjectile->ReconcileProjectile = this;
+	ReconcileProjectile = AuthoritativeProjectile;
+	ReconcileAlpha = KINDA_SMALL_NUMBER;
 }
 
 void ABSProjectile::DetonateAtLocation(const FVector& Location, const FRotator& Rotation)
 {
 	if (!bIsDetonated)
 	{
-		if (!HasAuthority())
+		if (bIsPredicted)
+		{
+			// Only play effects. Wait, hidden, for the server's projectile so it knows
+			// not to play them again.
+			SetActorLocationAndRotation(Location, Rotation);
+
+			bIsDetonated = true;
+			bDetonateEffectsPlayed = true;
+			OnDetonate();
+
+			SetActorEnableCollision(false);
+			SetActorHiddenInGame(true);
+			StopSimulation();
+			OnDeactivate();
+		}
+		else if (bIsReplica)
 		{
-			ServerDetonate(Location, Rotation);
+			// Replicas only detonate when the server's detonation event is received
 		}
 		else
 		{
-			TArray<AActor*> ToIgnore;
-			ToIgnore.Add(this);
-
-			bool bDamagedActor = UGameplayStatics::ApplyRadialDamageWithFalloff(this,
-				Damage.BaseDamage,
-				Damage.MinimumDamage,
-				Location,
-				Damage.InnerRadius,
-				Damage.OuterRadius,
-				Damage.DamageFalloff,
-				DamageTypeClass,
-				ToIgnore,
-				this,
-				GetInstigatorController());
+			ABSProjectileManager* const ProjectileManager = ABSProjectileManager::Get(GetWorld());
+
+			if (ProjectileManager)
+			{
+				// Resolved together with every other detonation this frame
+				FBSRadialDamageRequest Request;
+				Request.Params = Damage;
+				Request.Origin = Location;
+				Request.DamageTypeClass = DamageTypeClass;
+				Request.DamageCauser = this;
+				Request.Instigator = GetInstigatorController();
+
+				ProjectileManager->QueueRadialDamage(Request);
+			}
+			else
+			{
+				TArray<AActor*> ToIgnore;
+				ToIgnore.Add(this);
+
+				UGameplayStatics::ApplyRadialDamageWithFalloff(this,
+					Damage.BaseDamage,
+					Damage.MinimumDamage,
+					Location,
+					Damage.InnerRadius,
+					Damage.OuterRadius,
+					Damage.DamageFalloff,
+					DamageTypeClass,
+					ToIgnore,
+					this,
+					GetInstigatorController());
+			}
 
 			bIsDetonated = true;
 			OnDetonate();
 
+			if (ProjectileManager)
+			{
+				ProjectileManager->NotifyDetonated(this, Location);
+			}
+
 			Deactivate();
-			TearOff();
 		}
 	}
 }
@@ -113,25 +365,17 @@ void ABSProjectile::Deactivate()
 	if (!IsPendingKillPending())
 	{
 		SetActorEnableCollision(false);
-		ProjectileMovement->SetActive(false);
+		StopSimulation();
 
 		OnDeactivate();
-		SetLifeSpan(0.5f); // Allow replication time to clients for detonation
+
+		// Allow replication time to clients for detonation
+		GetWorldTimerManager().SetTimer(RecycleTimer, this, &ABSProjectile::Recycle, 0.5f);
 	}
 
 	bIsDetonated = true;
 }
 
-void ABSProjectile::ServerDetonate_Implementation(const FVector& Location, const FRotator& Rotation)
-{
-	DetonateAtLocation(Location, Rotation);
-}
-
-bool ABSProjectile::ServerDetonate_Validate(const FVector&, const FRotator&)
-{
-	return true;
-}
-
 void ABSProjectile::OnDetonate_Implementation()
 {
 	if (ExplosionEffect)
@@ -144,10 +388,52 @@ void ABSProjectile::OnDetonate_Implementation()
 	}
 }
 
-void ABSProjectile::OnRep_IsDetonated()
+void ABSProjectile::DetonateReplica(const FVector& Location)
 {
-	OnDetonate();
-	Destroy();
+	check(bIsReplica);
+
+	if (bIsDetonated)
+		return;
+
+	bIsDetonated = true;
+
+	if (ABSProjectile* const Predicted = ReconcileProjectile.Get())
+	{
+		// Detonate where the player last saw the projectile
+		SetActorLocation(Predicted->GetActorLocation());
+		Predicted->Recycle();
+		ReconcileProjectile.Reset();
+	}
+	else
+	{
+		SetActorLocation(Location);
+	}
+
+	if (!bDetonateEffectsPlayed)
+	{
+		OnDetonate();
+		bDetonateEffectsPlayed = true;
+	}
+
+	// Stay hidden until the server removes the projectile
+	StopSimulation();
+	SetActorEnableCollision(false);
+	SetActorHiddenInGame(true);
+}
+
+void ABSProjectile::ReconcileWithPrediction()
+{
+	// Hand off from the owning client's predicted projectile, if there is one
+	ABSWeapon* const Weapon = Cast<ABSWeapon>(GetOwner());
+	ABSCharacter* const Character = Weapon ? Weapon->GetCharacter() : nullptr;
+
+	if (Character && Character->IsLocallyControlled())
+	{
+		if (UBSProjectileShot* const ProjectileShot = Cast<UBSProjectileShot>(Weapon->GetShotType()))
+		{
+			ProjectileShot->ReconcileProjectile(this);
+		}
+	}
 }
 
 ABSImpactGrenade::ABSImpactGrenade(const FObjectInitializer& ObjectInitializer /*= FObjectInitializer::Get()*/)
@@ -156,14 +442,13 @@ ABSImpactGrenade::ABSImpactGrenade(const FObjectInitializer& ObjectInitializer /
 	FuzeTime = 2.f;
 }
 
-void ABSImpactGrenade::BeginPlay()
+void ABSImpactGrenade::OnArmed()
 {
-	Super::BeginPlay();
+	Super::OnArmed();
 
-	if (HasAuthority() && FuzeTime > 0.f)
+	if (FuzeTime > 0.f)
 	{
-		FTimerHandle FuzeHandle;
-		GetWorld()->GetTimerManager().SetTimer(FuzeHandle, this, &ABSImpactGrenade::Detonate, FuzeTime);
+		GetWorldTimerManager().SetTimer(FuzeTimer, this, &ABSImpactGrenade::Detonate, FuzeTime);
 	}
 }
 
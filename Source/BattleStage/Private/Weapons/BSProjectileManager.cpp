@@ -0,0 +1,431 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BattleStage.h"
+#include "BSProjectileManager.h"
+
+#include "GameFramework/ProjectileMovementComponent.h"
+
+#include "BSGameState.h"
+#include "BSProjectile.h"
+#include "BSWeapon.h"
+
+ABSProjectileManager::ABSProjectileManager(const FObjectInitializer& ObjectInitializer /*= FObjectInitializer::Get()*/)
+	: Super(ObjectInitializer)
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = true;
+
+	bReplicates = true;
+	bAlwaysRelevant = true;
+
+	ReplicatedProjectiles.Manager = this;
+}
+
+void ABSProjectileManager::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(ABSProjectileManager, ReplicatedProjectiles);
+}
+
+void ABSProjectileManager::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (HasAuthority())
+	{
+		for (const FProjectilePoolPrewarm& Entry : Prewarm)
+		{
+			if (!Entry.ProjectileClass)
+				continue;
+
+			TArray<TWeakObjectPtr<ABSProjectile>>& Pool = FreeProjectiles.FindOrAdd(Entry.ProjectileClass);
+
+			for (int32 i = 0; i < Entry.Count; ++i)
+			{
+				if (ABSProjectile* const Projectile = SpawnPooledProjectile(Entry.ProjectileClass))
+				{
+					Pool.Add(Projectile);
+				}
+			}
+		}
+	}
+}
+
+void ABSProjectileManager::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (SimProjectiles.Num() > 0)
+	{
+		SimulateProjectiles(DeltaSeconds);
+	}
+
+	// Detonations from this step and since the last tick
+	if (RadialDamageResolver.HasPending())
+	{
+		RadialDamageResolver.Resolve(GetWorld());
+	}
+}
+
+ABSProjectileManager* ABSProjectileManager::Get(const UWorld* World)
+{
+	const ABSGameState* const GameState = World ? World->GetGameState<ABSGameState>() : nullptr;
+	return GameState ? GameState->GetProjectileManager() : nullptr;
+}
+
+ABSProjectile* ABSProjectileManager::AcquireProjectile(TSubclassOf<ABSProjectile> ProjectileClass, const FTransform& SpawnTransform, AActor* NewOwner, APawn* NewInstigator, const uint16 ShotIndex, const bool bPredicted)
+{
+	ABSProjectile* const Projectile = TakeFromPool(ProjectileClass);
+
+	if (Projectile)
+	{
+		Projectile->bIsPredicted = bPredicted;
+		Projectile->bIsReplica = false;
+		Projectile->Arm(SpawnTransform, NewOwner, NewInstigator, ShotIndex);
+
+		if (!bPredicted && GetNetMode() != NM_Client)
+		{
+			// Replicate launch data for clients to simulate their own replica
+			Projectile->ProjectileId = NextProjectileId++;
+
+			FProjectileRep& ProjectileRep = ReplicatedProjectiles.Projectiles[ReplicatedProjectiles.Projectiles.AddDefaulted()];
+			ProjectileRep.ProjectileId = Projectile->ProjectileId;
+			ProjectileRep.ProjectileClass = ProjectileClass;
+			ProjectileRep.Weapon = Cast<ABSWeapon>(NewOwner);
+			ProjectileRep.ShotIndex = ShotIndex;
+			ProjectileRep.SpawnTime = GetWorld()->GetTimeSeconds();
+			ProjectileRep.Origin = SpawnTransform.GetLocation();
+			ProjectileRep.Velocity = SpawnTransform.GetRotation().Vector() * Projectile->GetProjectileMovement()->InitialSpeed;
+
+			ReplicatedProjectiles.MarkItemDirty(ProjectileRep);
+		}
+	}
+
+	return Projectile;
+}
+
+void ABSProjectileManager::ReleaseProjectile(ABSProjectile* Projectile)
+{
+	check(Projectile);
+
+	if (!Projectile->IsArmed())
+		return;
+
+	Projectile->Disarm();
+
+	if (Projectile->bIsReplica)
+	{
+		const TWeakObjectPtr<ABSProjectile>* const Replica = Replicas.Find(Projectile->ProjectileId);
+		if (Replica && Replica->Get() == Projectile)
+		{
+			Replicas.Remove(Projectile->ProjectileId);
+		}
+	}
+	else if (!Projectile->bIsPredicted && GetNetMode() != NM_Client)
+	{
+		const int32 Index = ReplicatedProjectiles.Projectiles.IndexOfByPredicate([Projectile](const FProjectileRep& ProjectileRep) { return ProjectileRep.ProjectileId == Projectile->ProjectileId; });
+		if (Index != INDEX_NONE)
+		{
+			ReplicatedProjectiles.Projectiles.RemoveAtSwap(Index);
+			ReplicatedProjectiles.MarkArrayDirty();
+		}
+	}
+
+	FreeProjectiles.FindOrAdd(Projectile->GetClass()).Add(Projectile);
+}
+
+void ABSProjectileManager::NotifyDetonated(ABSProjectile* Projectile, const FVector& Location)
+{
+	check(Projectile);
+
+	for (FProjectileRep& ProjectileRep : ReplicatedProjectiles.Projectiles)
+	{
+		if (ProjectileRep.ProjectileId == Projectile->ProjectileId)
+		{
+			ProjectileRep.DetonateLocation = Location;
+			ProjectileRep.bDetonated = true;
+
+			ReplicatedProjectiles.MarkItemDirty(ProjectileRep);
+			break;
+		}
+	}
+}
+
+void ABSProjectileManager::QueueRadialDamage(const FBSRadialDamageRequest& Request)
+{
+	RadialDamageResolver.Queue(Request);
+}
+
+ABSProjectile* ABSProjectileManager::TakeFromPool(TSubclassOf<ABSProjectile> ProjectileClass)
+{
+	if (!ProjectileClass)
+		return nullptr;
+
+	ABSProjectile* Projectile = nullptr;
+
+	if (TArray<TWeakObjectPtr<ABSProjectile>>* const Pool = FreeProjectiles.Find(ProjectileClass))
+	{
+		while (!Projectile && Pool->Num() > 0)
+		{
+			Projectile = Pool->Pop(false).Get();
+		}
+	}
+
+	return Projectile ? Projectile : SpawnPooledProjectile(ProjectileClass);
+}
+
+ABSProjectile* ABSProjectileManager::SpawnPooledProjectile(TSubclassOf<ABSProjectile> ProjectileClass)
+{
+	ABSProjectile* const Projectile = GetWorld()->SpawnActorDeferred<ABSProjectile>(ProjectileClass, FTransform::Identity, this, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+
+	if (Projectile)
+	{
+		Projectile->SetPooled();
+		Projectile->FinishSpawning(FTransform::Identity);
+		Projectile->Disarm();
+	}
+
+	return Projectile;
+}
+
+float ABSProjectileManager::GetServerWorldTime() const
+{
+	const AGameState* const GameState = GetWorld()->GameState;
+	return GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+}
+
+void ABSProjectileManager::OnProjectileAdded(const FProjectileRep& ProjectileRep)
+{
+	// Projectiles that detonated before becoming relevant have nothing left to show
+	if (ProjectileRep.bDetonated || Replicas.Contains(ProjectileRep.ProjectileId))
+		return;
+
+	ABSProjectile* const Replica = TakeFromPool(ProjectileRep.ProjectileClass);
+	if (!Replica)
+		return;
+
+	ABSWeapon* const Weapon = ProjectileRep.Weapon;
+	const FVector Origin = ProjectileRep.Origin;
+	const FVector Velocity = ProjectileRep.Velocity;
+
+	Replica->bIsPredicted = false;
+	Replica->bIsReplica = true;
+	Replica->ProjectileId = ProjectileRep.ProjectileId;
+	Replica->Arm(FTransform(Velocity.Rotation(), Origin), Weapon, Weapon ? Weapon->GetCharacter() : nullptr, ProjectileRep.ShotIndex);
+
+	// Catch up to where the server's projectile is now
+	const UProjectileMovementComponent* const Movement = Replica->GetProjectileMovement();
+	const float GravityZ = GetWorld()->GetGravityZ() * Movement->ProjectileGravityScale;
+	const float Elapsed = FMath::Clamp(GetServerWorldTime() - ProjectileRep.SpawnTime, 0.f, Replica->LifeTime);
+
+	const FVector Gravity(0.f, 0.f, GravityZ);
+	Replica->SetActorLocation(Origin + Velocity * Elapsed + 0.5f * Gravity * FMath::Square(Elapsed));
+	StartSimulating(Replica, Velocity + Gravity * Elapsed);
+
+	Replicas.Add(ProjectileRep.ProjectileId, Replica);
+
+	Replica->ReconcileWithPrediction();
+}
+
+void ABSProjectileManager::OnProjectileChanged(const FProjectileRep& ProjectileRep)
+{
+	if (ProjectileRep.bDetonated)
+	{
+		if (ABSProjectile* const Replica = Replicas.FindRef(ProjectileRep.ProjectileId).Get())
+		{
+			Replica->DetonateReplica(ProjectileRep.DetonateLocation);
+		}
+	}
+}
+
+void ABSProjectileManager::OnProjectileRemoved(const FProjectileRep& ProjectileRep)
+{
+	if (ABSProjectile* const Replica = Replicas.FindRef(ProjectileRep.ProjectileId).Get())
+	{
+		Replica->Recycle();
+	}
+
+	Replicas.Remove(ProjectileRep.ProjectileId);
+}
+
+void ABSProjectileManager::StartSimulating(ABSProjectile* Projectile, const FVector& Velocity)
+{
+	check(Projectile);
+
+	const UProjectileMovementComponent* const Movement = Projectile->GetProjectileMovement();
+
+	if (Projectile->SimIndex == INDEX_NONE)
+	{
+		Projectile->SimIndex = SimProjectiles.Add(Projectile);
+		SimLocations.AddUninitialized();
+		SimVelocities.AddUninitialized();
+		SimGravityZ.AddUninitialized();
+		SimMaxSpeeds.AddUninitialized();
+	}
+
+	const int32 Index = Projectile->SimIndex;
+	SimLocations[Index] = Projectile->GetActorLocation();
+	SimVelocities[Index] = Velocity;
+	SimGravityZ[Index] = GetWorld()->GetGravityZ() * Movement->ProjectileGravityScale;
+	SimMaxSpeeds[Index] = Movement->MaxSpeed;
+}
+
+void ABSProjectileManager::StopSimulating(ABSProjectile* Projectile)
+{
+	check(Projectile);
+
+	const int32 Index = Projectile->SimIndex;
+	if (SimProjectiles.IsValidIndex(Index) && SimProjectiles[Index] == Projectile)
+	{
+		RemoveSimulated(Index);
+	}
+
+	Projectile->SimIndex = INDEX_NONE;
+}
+
+void ABSProjectileManager::RemoveSimulated(const int32 Index)
+{
+	SimProjectiles.RemoveAtSwap(Index, 1, false);
+	SimLocations.RemoveAtSwap(Index, 1, false);
+	SimVelocities.RemoveAtSwap(Index, 1, false);
+	SimGravityZ.RemoveAtSwap(Index, 1, false);
+	SimMaxSpeeds.RemoveAtSwap(Index, 1, false);
+
+	if (SimProjectiles.IsValidIndex(Index) && SimProjectiles[Index])
+	{
+		SimProjectiles[Index]->SimIndex = Index;
+	}
+}
+
+void ABSProjectileManager::SimulateProjectiles(const float DeltaSeconds)
+{
+	// Drop projectiles that were destroyed without being stopped
+	for (int32 i = SimProjectiles.Num() - 1; i >= 0; --i)
+	{
+		if (!SimProjectiles[i] || SimProjectiles[i]->IsPendingKill())
+		{
+			RemoveSimulated(i);
+		}
+	}
+
+	const int32 NumProjectiles = SimProjectiles.Num();
+
+	// Euler step every projectile
+	StepStartLocations = SimLocations;
+
+	for (int32 i = 0; i < NumProjectiles; ++i)
+	{
+		FVector& Velocity = SimVelocities[i];
+		Velocity.Z += SimGravityZ[i] * DeltaSeconds;
+
+		if (SimMaxSpeeds[i] > 0.f)
+		{
+			Velocity = Velocity.GetClampedToMaxSize(SimMaxSpeeds[i]);
+		}
+
+		SimLocations[i] += Velocity * DeltaSeconds;
+	}
+
+	// Sweep each projectile's movement for this step, one sweep per projectile
+	static const FName ProjectileSweepTag(TEXT("ProjectileSweep"));
+
+	StepHits.Reset();
+	StepHitProjectiles.Reset();
+
+	for (int32 i = 0; i < NumProjectiles; ++i)
+	{
+		ABSProjectile* const Projectile = SimProjectiles[i];
+		const USphereComponent* const CollisionComp = Projectile->GetCollisionComp();
+
+		if (!Projectile->GetActorEnableCollision())
+			continue;
+
+		FCollisionQueryParams QueryParams(ProjectileSweepTag, false, Projectile);
+		QueryParams.AddIgnoredActor(Projectile->GetOwner());
+		QueryParams.AddIgnoredActor(Projectile->GetInstigator());
+
+		const FCollisionResponseParams ResponseParams(CollisionComp->GetCollisionResponseToChannels());
+		const FCollisionShape Shape = FCollisionShape::MakeSphere(CollisionComp->GetScaledSphereRadius());
+
+		FHitResult Hit;
+		if (GetWorld()->SweepSingleByChannel(Hit, StepStartLocations[i], SimLocations[i], FQuat::Identity, CollisionComp->GetCollisionObjectType(), Shape, QueryParams, ResponseParams))
+		{
+			SimLocations[i] = Hit.Location;
+
+			StepHits.Add(Hit);
+			StepHitProjectiles.Add(Projectile);
+		}
+	}
+
+	// Move the actors to their simulated location
+	for (int32 i = 0; i < NumProjectiles; ++i)
+	{
+		ABSProjectile* const Projectile = SimProjectiles[i];
+		const UProjectileMovementComponent* const Movement = Projectile->GetProjectileMovement();
+
+		// Gathered by replicated movement
+		Projectile->GetCollisionComp()->ComponentVelocity = SimVelocities[i];
+
+		if (Movement->bRotationFollowsVelocity && !SimVelocities[i].IsNearlyZero())
+		{
+			Projectile->SetActorLocationAndRotation(SimLocations[i], SimVelocities[i].Rotation());
+		}
+		else
+		{
+			Projectile->SetActorLocation(SimLocations[i]);
+		}
+	}
+
+	// Notify hits last since gameplay callbacks can stop or recycle any projectile
+	for (int32 i = 0; i < StepHits.Num(); ++i)
+	{
+		ABSProjectile* const Projectile = StepHitProjectiles[i].Get();
+		if (!Projectile || Projectile->SimIndex == INDEX_NONE)
+			continue;
+
+		FVector Velocity = SimVelocities[Projectile->SimIndex];
+		const bool bKeepSimulating = Projectile->HandleSimulatedHit(StepHits[i], Velocity);
+
+		// The callback may have stopped the projectile, or started it again with a new velocity
+		if (Projectile->SimIndex != INDEX_NONE)
+		{
+			if (bKeepSimulating)
+			{
+				SimVelocities[Projectile->SimIndex] = Velocity;
+			}
+			else
+			{
+				StopSimulating(Projectile);
+			}
+		}
+	}
+}
+
+//-----------------------------------------------------------------
+// FProjectileRep
+//-----------------------------------------------------------------
+
+void FProjectileRep::PostReplicatedAdd(const FProjectileRepArray& InArray)
+{
+	if (InArray.Manager)
+	{
+		InArray.Manager->OnProjectileAdded(*this);
+	}
+}
+
+void FProjectileRep::PostReplicatedChange(const FProjectileRepArray& InArray)
+{
+	if (InArray.Manager)
+	{
+		InArray.Manager->OnProjectileChanged(*this);
+	}
+}
+
+void FProjectileRep::PreReplicatedRemove(const FProjectileRepArray& InArray)
+{
+	if (InArray.Manager)
+	{
+		InArray.Manager->OnProjectileRemoved(*this);
+	}
+}
@@ -3,42 +3,92 @@
 #include "BattleStage.h"
 #include "BSProjectileShot.h"
 #include "BSProjectile.h"
+#include "BSProjectileManager.h"
 #include "BSWeapon.h"
 
 bool UBSProjectileShot::GetShotData(FShotData& OutShotData) const
 {
 	const ABSWeapon* const Weapon = GetWeapon();
 	OutShotData.Start = Weapon->GetFireLocation();
-
-	// Get a random weapon spread for the shot
-	const int32 RandomSeed = FMath::Rand();
-	FRandomStream SpreadStream(RandomSeed);
-	const float BaseSpread = FMath::DegreesToRadians(Weapon->GetCurrentSpread());
+	OutShotData.AimRotation = Weapon->GetFireRotation();
+	OutShotData.Spread = Weapon->GetCurrentSpread();
 
 	// Use spread to offset shot
-	const FVector TrueAimDirection = Weapon->GetFireRotation().Vector();
-	OutShotData.Direction = SpreadStream.VRandCone(TrueAimDirection, BaseSpread);
+	Weapon->ApplyShotSpread(OutShotData);
 
 	OutShotData.bImpactNeeded = false;
 
 	return true;
 }
 
+void UBSProjectileShot::PreInvokeShot(const FShotData& ShotData)
+{
+	if (!GetWeapon()->HasAuthority())
+	{
+		// Forget predictions that already timed out or were recycled for another shot
+		for (auto It = PredictedProjectiles.CreateIterator(); It; ++It)
+		{
+			if (!IsPredictionPending(It.Value(), It.Key()))
+			{
+				It.RemoveCurrent();
+			}
+		}
+
+		if (ABSProjectile* const Projectile = SpawnProjectile(ShotData, true))
+		{
+			PredictedProjectiles.Add(ShotData.ShotIndex, Projectile);
+		}
+	}
+}
+
 void UBSProjectileShot::InvokeShot(const FShotData& ShotData)
 {
-	SpawnProjectile(ShotData.Start, ShotData.Direction);
+	SpawnProjectile(ShotData, false);
+}
+
+void UBSProjectileShot::ReconcileProjectile(ABSProjectile* Projectile)
+{
+	TWeakObjectPtr<ABSProjectile> Predicted;
+	if (PredictedProjectiles.RemoveAndCopyValue(Projectile->GetShotIndex(), Predicted) && IsPredictionPending(Predicted, Projectile->GetShotIndex()))
+	{
+		Predicted->BeginReconcile(Projectile);
+	}
 }
 
-void UBSProjectileShot::SpawnProjectile(FVector Location, FVector_NetQuantize Direction) const
+ABSProjectile* UBSProjectileShot::SpawnProjectile(const FShotData& ShotData, const bool bPredicted) const
 {
+	ABSProjectile* Projectile = nullptr;
+
 	if (ProjectileType)
 	{
 		ABSWeapon* const Weapon = GetWeapon();
+		const FTransform SpawnTransform(ShotData.Direction.Rotation(), ShotData.Start);
 
-		FActorSpawnParameters SpawnParams;
-		SpawnParams.Owner = Weapon;
-		SpawnParams.Instigator = Weapon->GetCharacter();
+		if (ABSProjectileManager* const ProjectileManager = ABSProjectileManager::Get(GetWorld()))
+		{
+			Projectile = ProjectileManager->AcquireProjectile(ProjectileType, SpawnTransform, Weapon, Weapon->GetCharacter(), ShotData.ShotIndex, bPredicted);
+		}
+		else
+		{
+			// No manager has replicated yet, fall back to a projectile that isn't pooled
+			Projectile = GetWorld()->SpawnActorDeferred<ABSProjectile>(ProjectileType, SpawnTransform, Weapon, Weapon->GetCharacter());
+			if (Projectile)
+			{
+				if (bPredicted)
+				{
+					Projectile->SetPredicted();
+				}
 
-		GetWorld()->SpawnActor<ABSProjectile>(ProjectileType, Location, Direction.Rotation(), SpawnParams);
+				Projectile->FinishSpawning(SpawnTransform);
+				Projectile->Arm(SpawnTransform, Weapon, Weapon->GetCharacter(), ShotData.ShotIndex);
+			}
+		}
 	}
-}
\ No newline at end of file
+
+	return Projectile;
+}
+
+bool UBSProjectileShot::IsPredictionPending(const TWeakObjectPtr<ABSProjectile>& Predicted, const uint16 ShotIndex)
+{
+	return Predicted.IsValid() && Predicted->IsArmed() && Predicted->GetShotIndex() == ShotIndex;
+}
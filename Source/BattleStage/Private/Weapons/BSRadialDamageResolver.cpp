@@ -0,0 +1,173 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BattleStage.h"
+#include "BSRadialDamageResolver.h"
+
+#include "EngineUtils.h"
+
+#include "BSLagCompensation.h"
+
+// Detonations closer than this share occlusion results
+static const float OCCLUSION_CACHE_GRID = 16.f;
+
+void FBSRadialDamageResolver::Queue(const FBSRadialDamageRequest& Request)
+{
+	Pending.Add(Request);
+}
+
+void FBSRadialDamageResolver::Resolve(UWorld* World)
+{
+	if (Pending.Num() == 0)
+		return;
+
+	// Pending requests may be added while damage is applied, so resolve a snapshot
+	TArray<FBSRadialDamageRequest> Requests = MoveTemp(Pending);
+	Pending.Reset();
+
+	CellSize = 0.f;
+	for (const FBSRadialDamageRequest& Request : Requests)
+	{
+		CellSize = FMath::Max(CellSize, Request.Params.OuterRadius);
+	}
+
+	BucketCandidates(World);
+
+	CandidateHits.Reset();
+	OcclusionCache.Reset();
+	OcclusionStarts.Reset();
+	OcclusionEnds.Reset();
+
+	// Find every character in range of each detonation
+	for (int32 RequestIndex = 0; RequestIndex < Requests.Num(); ++RequestIndex)
+	{
+		const FBSRadialDamageRequest& Request = Requests[RequestIndex];
+		const FIntVector OriginCell = GetCell(Request.Origin);
+
+		// Cells are at least as large as the damage radius plus a character's extent, so neighbouring cells cover it
+		for (int32 X = -1; X <= 1; ++X)
+		for (int32 Y = -1; Y <= 1; ++Y)
+		for (int32 Z = -1; Z <= 1; ++Z)
+		{
+			const TArray<int32>* const Cell = Cells.Find(OriginCell + FIntVector(X, Y, Z));
+			if (!Cell)
+				continue;
+
+			for (const int32 CandidateIndex : *Cell)
+			{
+				const FCandidate& Candidate = Candidates[CandidateIndex];
+
+				const FVector AxisOffset(0.f, 0.f, Candidate.AxisHalfLength);
+				const FVector AxisPoint = FMath::ClosestPointOnSegment(Request.Origin, Candidate.Center - AxisOffset, Candidate.Center + AxisOffset);
+				const FVector ToOrigin = Request.Origin - AxisPoint;
+				const float AxisDistance = ToOrigin.Size();
+
+				if (AxisDistance - Candidate.Radius > Request.Params.OuterRadius)
+					continue;
+
+				FCandidateHit& CandidateHit = CandidateHits[CandidateHits.AddDefaulted()];
+				CandidateHit.RequestIndex = RequestIndex;
+				CandidateHit.CandidateIndex = CandidateIndex;
+				CandidateHit.ImpactPoint = AxisDistance > Candidate.Radius ? AxisPoint + ToOrigin * (Candidate.Radius / AxisDistance) : Request.Origin;
+				CandidateHit.OcclusionIndex = AddOcclusionTest(Request.Origin, Candidate.Center, CandidateIndex);
+			}
+		}
+	}
+
+	// Trace each unique occlusion test once
+	OcclusionResults.SetNumUninitialized(OcclusionStarts.Num());
+	for (int32 i = 0; i < OcclusionStarts.Num(); ++i)
+	{
+		OcclusionResults[i] = FBSLagCompensation::IsOccluded(World, OcclusionStarts[i], OcclusionEnds[i], nullptr);
+	}
+
+	// Apply damage
+	for (const FCandidateHit& CandidateHit : CandidateHits)
+	{
+		if (OcclusionResults[CandidateHit.OcclusionIndex])
+			continue;
+
+		const FBSRadialDamageRequest& Request = Requests[CandidateHit.RequestIndex];
+		ABSCharacter* const Character = Candidates[CandidateHit.CandidateIndex].Character;
+
+		// An earlier detonation this pass may have killed or removed the character
+		if (!Character || Character->IsPendingKill() || Character->GetHealth() <= 0)
+			continue;
+
+		FHitResult Hit(Character, Character->GetCapsuleComponent(), CandidateHit.ImpactPoint, (Request.Origin - CandidateHit.ImpactPoint).GetSafeNormal());
+		Hit.TraceStart = Request.Origin;
+		Hit.TraceEnd = CandidateHit.ImpactPoint;
+
+		FRadialDamageEvent DamageEvent;
+		DamageEvent.DamageTypeClass = Request.DamageTypeClass;
+		DamageEvent.Origin = Request.Origin;
+		DamageEvent.Params = Request.Params;
+		DamageEvent.ComponentHits.Add(Hit);
+
+		Character->TakeDamage(Request.Params.BaseDamage, DamageEvent, Request.Instigator.Get(), Request.DamageCauser.Get());
+	}
+}
+
+void FBSRadialDamageResolver::BucketCandidates(UWorld* World)
+{
+	Candidates.Reset();
+	Cells.Reset();
+
+	float MaxExtent = 0.f;
+
+	for (TActorIterator<ABSCharacter> It(World); It; ++It)
+	{
+		ABSCharacter* const Character = *It;
+
+		if (Character->GetHealth() <= 0)
+			continue;
+
+		const UCapsuleComponent* const Capsule = Character->GetCapsuleComponent();
+
+		const int32 CandidateIndex = Candidates.AddDefaulted();
+		FCandidate& Candidate = Candidates[CandidateIndex];
+		Candidate.Character = Character;
+		Candidate.Center = Capsule->GetComponentLocation();
+		Candidate.Radius = Capsule->GetScaledCapsuleRadius();
+		Candidate.AxisHalfLength = FMath::Max(0.f, Capsule->GetScaledCapsuleHalfHeight() - Candidate.Radius);
+
+		MaxExtent = FMath::Max(MaxExtent, Capsule->GetScaledCapsuleHalfHeight());
+	}
+
+	// Characters are bucketed by their center, so cells need to cover their extent too
+	CellSize += MaxExtent + 1.f;
+
+	for (int32 i = 0; i < Candidates.Num(); ++i)
+	{
+		Cells.FindOrAdd(GetCell(Candidates[i].Center)).Add(i);
+	}
+}
+
+FIntVector FBSRadialDamageResolver::GetCell(const FVector& Location) const
+{
+	return FIntVector(
+		FMath::FloorToInt(Location.X / CellSize),
+		FMath::FloorToInt(Location.Y / CellSize),
+		FMath::FloorToInt(Location.Z / CellSize));
+}
+
+int32 FBSRadialDamageResolver::AddOcclusionTest(const FVector& Start, const FVector& End, const int32 CandidateIndex)
+{
+	const FIntVector OriginKey(
+		FMath::RoundToInt(Start.X / OCCLUSION_CACHE_GRID),
+		FMath::RoundToInt(Start.Y / OCCLUSION_CACHE_GRID),
+		FMath::RoundToInt(Start.Z / OCCLUSION_CACHE_GRID));
+
+	TMap<int32, int32>& OriginTests = OcclusionCache.FindOrAdd(OriginKey);
+
+	if (const int32* const Existing = OriginTests.Find(CandidateIndex))
+	{
+		return *Existing;
+	}
+
+	const int32 Index = OcclusionStarts.Add(Start);
+	OcclusionEnds.Add(End);
+
+	OriginTests.Add(CandidateIndex, Index);
+
+	return Index;
+}
@@ -3,6 +3,89 @@
 #include "BattleStage.h"
 #include "BSShotType.h"
 #include "BSWeapon.h"
+#include "BSLagCompensation.h"
+
+#include "PhysicalMaterials/PhysicalMaterial.h"
+
+FShotHitRecord::FShotHitRecord(const FHitResult& Hit)
+	: Actor(Hit.Actor)
+	, ImpactPoint(Hit.ImpactPoint)
+	, SurfaceType(UPhysicalMaterial::DetermineSurfaceType(Hit.PhysMaterial.Get()))
+{
+	if (const USkinnedMeshComponent* const SkinnedMesh = Cast<USkinnedMeshComponent>(Hit.Component.Get()))
+	{
+		BoneIndex = SkinnedMesh->GetBoneIndex(Hit.BoneName);
+	}
+}
+
+FHitResult FShotHitRecord::ToHitResult(const FVector& TraceStart, const FVector& Direction) const
+{
+	FHitResult Hit(Actor.Get(), nullptr, ImpactPoint, -Direction);
+	Hit.bBlockingHit = true;
+	Hit.ImpactPoint = ImpactPoint;
+	Hit.TraceStart = TraceStart;
+	Hit.TraceEnd = ImpactPoint;
+	Hit.Distance = FVector::Dist(TraceStart, ImpactPoint);
+
+	if (AActor* const HitActor = Actor.Get())
+	{
+		if (const ACharacter* const Character = Cast<ACharacter>(HitActor))
+		{
+			Hit.Component = Character->GetMesh();
+
+			if (BoneIndex != INDEX_NONE)
+			{
+				Hit.BoneName = Character->GetMesh()->GetBoneName(BoneIndex);
+			}
+		}
+		else
+		{
+			Hit.Component = Cast<UPrimitiveComponent>(HitActor->GetRootComponent());
+		}
+	}
+
+	return Hit;
+}
+
+bool FShotHitRecord::NetSerialize(FArchive& Ar, class UPackageMap* Map, const FVector& Origin, bool& bOutSuccess)
+{
+	bOutSuccess = true;
+
+	UObject* ActorObject = Actor.Get();
+	bOutSuccess &= Map->SerializeObject(Ar, AActor::StaticClass(), ActorObject);
+
+	if (Ar.IsLoading())
+	{
+		Actor = Cast<AActor>(ActorObject);
+	}
+
+	bOutSuccess &= SerializeImpact(Ar, Origin);
+
+	return true;
+}
+
+bool FShotHitRecord::SerializeImpact(FArchive& Ar, const FVector& Origin)
+{
+	// Offset by one so INDEX_NONE packs into a single byte
+	uint32 PackedBoneIndex = static_cast<uint32>(BoneIndex + 1);
+	Ar.SerializeIntPacked(PackedBoneIndex);
+
+	// Impact relative to the origin, in tenths of a unit
+	FVector ImpactOffset = ImpactPoint - Origin;
+	const bool bInRange = SerializePackedVector<10, 20>(ImpactOffset, Ar);
+
+	uint32 PackedSurfaceType = SurfaceType.GetValue();
+	Ar.SerializeInt(PackedSurfaceType, SurfaceType_Max);
+
+	if (Ar.IsLoading())
+	{
+		BoneIndex = static_cast<int32>(PackedBoneIndex) - 1;
+		ImpactPoint = Origin + ImpactOffset;
+		SurfaceType = static_cast<EPhysicalSurface>(PackedSurfaceType);
+	}
+
+	return bInRange;
+}
 
 class UWorld* UBSShotType::GetWorld() const
 {
@@ -18,3 +101,13 @@ ABSWeapon* UBSShotType::GetWeapon() const
 {
 	return static_cast<ABSWeapon*>(GetOuter());
 }
+
+float UBSShotType::GetRewindTime(const FShotData& ShotData) const
+{
+	if (ShotData.RewindTime > 0.f)
+	{
+		return ShotData.RewindTime;
+	}
+
+	return FBSLagCompensation::GetRewindTime(GetWeapon()->GetInstigatorController(), GetWorld());
+}
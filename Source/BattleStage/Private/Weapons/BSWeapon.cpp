@@ -4,30 +4,53 @@
 
 #include "Engine/ActorChannel.h"
 
+#include "BSCharacterMovementComponent.h"
+#include "BSLagCompensation.h"
 #include "BSNetworkUtils.h"
 #include "BSShotType.h"
 #include "BSWeapon.h"
 
+// Max shots fired in a single frame. Shots due past this after a long hitch are dropped.
+static const int32 MAX_SHOTS_PER_FRAME = 16;
+
+// Number of shots in a recoil pattern. Must be a power of two.
+static const int32 RECOIL_PATTERN_LENGTH = 32;
+
+// Degrees a client's shot spread may be below the server's spread. Covers movement and recoil
+// timing differences between the client and server.
+static const float SHOT_SPREAD_TOLERANCE = 0.5f;
+
+// Seconds a shot's move timestamp may be ahead of the last move the server received. Covers
+// moves held back to be combined. Limits how far ahead a client can claim a shot was fired.
+static const float MAX_SHOT_TIMESTAMP_LEAD = 0.25f;
+
+// Seconds before the end of the server's transition a shot may be fired at
+static const float TRANSITION_TIMESTAMP_TOLERANCE = 0.05f;
+
+#if WITH_EDITOR
+void FWeaponAnim::CacheLengths()
+{
+	const UAnimMontage* const FirstPersonMontage = FirstPerson.IsNull() ? nullptr : Cast<UAnimMontage>(FirstPerson.ToStringReference().TryLoad());
+	FirstPersonLength = FirstPersonMontage ? FirstPersonMontage->GetPlayLength() : 0.f;
+
+	const UAnimMontage* const ThirdPersonMontage = ThirdPerson.IsNull() ? nullptr : Cast<UAnimMontage>(ThirdPerson.ToStringReference().TryLoad());
+	ThirdPersonLength = ThirdPersonMontage ? ThirdPersonMontage->GetPlayLength() : 0.f;
+}
+#endif
+
 ABSWeapon::ABSWeapon(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 	, MuzzleSocket(TEXT("MuzzleAttach"))
 	, ShotTypeClass(nullptr)
 {
+	// Only ticks while the local player is firing or recovering from recoil
 	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+
 	bReplicates = true;
 	bCanBeDamaged = false;
 	bNetUseOwnerRelevancy = true;
 
-	// First person weapon mesh
-	MeshFP = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("MeshFP"));
-	MeshFP->SetCollisionProfileName("CharacterMesh");
-	MeshFP->SetCastShadow(true);
-	MeshFP->bSelfShadowOnly = true;
-	MeshFP->bDisableClothSimulation = true;
-	MeshFP->bReceivesDecals = false;
-	MeshFP->bOnlyOwnerSee = true;
-	RootComponent = MeshFP;
-
 	// Third person weapon mesh
 	MeshTP = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("MeshTP"));
 	MeshTP->SetCollisionProfileName("CharacterMesh");
@@ -35,6 +58,17 @@ ABSWeapon::ABSWeapon(const FObjectInitializer& ObjectInitializer)
 	MeshTP->bReceivesDecals = false;
 	MeshTP->bDisableClothSimulation = true;
 	MeshTP->bOwnerNoSee = true;
+	RootComponent = MeshTP;
+
+	// First person weapon mesh. Only registered once the weapon is attached to a first person character.
+	MeshFP = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("MeshFP"));
+	MeshFP->SetCollisionProfileName("CharacterMesh");
+	MeshFP->SetCastShadow(true);
+	MeshFP->bSelfShadowOnly = true;
+	MeshFP->bDisableClothSimulation = true;
+	MeshFP->bReceivesDecals = false;
+	MeshFP->bOnlyOwnerSee = true;
+	MeshFP->bAutoRegister = false;
 
 	// Default weapon fire data
 	WeaponStats.MaxAmmo = 120;
@@ -52,14 +86,6 @@ ABSWeapon::ABSWeapon(const FObjectInitializer& ObjectInitializer)
 	WeaponStats.bIsAuto = true;
 }
 
-void ABSWeapon::PostInitProperties()
-{
-	Super::PostInitProperties();
-
-	RemainingClip = FMath::Min(WeaponStats.ClipSize, WeaponStats.MaxAmmo);
-	RemainingAmmo = FMath::Max(WeaponStats.MaxAmmo - RemainingClip, 0);
-}
-
 bool ABSWeapon::ReplicateSubobjects(class UActorChannel *Channel, class FOutBunch *Bunch, FReplicationFlags *RepFlags)
 {
 	bool bWroteSomething = Super::ReplicateSubobjects(Channel, Bunch, RepFlags);
@@ -76,14 +102,126 @@ void ABSWeapon::PostInitializeComponents()
 {
 	Super::PostInitializeComponents();
 
-	if (HasAuthority() && ShotTypeClass)
+	if (HasAuthority())
 	{
-		ShotType = NewObject<UBSShotType>(this, ShotTypeClass, TEXT("ShotType"));
+		SpreadSeed = FMath::Rand();
+
+		if (ShotTypeClass)
+		{
+			ShotType = NewObject<UBSShotType>(this, ShotTypeClass, TEXT("ShotType"));
+		}
 	}
 
+	if (GetNetMode() == NM_DedicatedServer)
+	{
+		// Nobody views the weapon in first person on a dedicated server
+		MeshFP->DestroyComponent();
+		MeshFP = nullptr;
+	}
+
+	CompileStats();
+
 	DetachFromOwner(); // Will attach on unequip, stay hidden for now.
 }
 
+#if WITH_EDITOR
+void ABSWeapon::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	CacheAnimLengths();
+}
+
+void ABSWeapon::PostLoad()
+{
+	Super::PostLoad();
+
+	// Weapons saved before the lengths were cached, or whose montages changed since, are fixed on load
+	if (GIsEditor && HasAnyFlags(RF_ClassDefaultObject | RF_ArchetypeObject))
+	{
+		CacheAnimLengths();
+	}
+}
+
+void ABSWeapon::PreSave()
+{
+	Super::PreSave();
+
+	if (HasAnyFlags(RF_ClassDefaultObject | RF_ArchetypeObject))
+	{
+		CacheAnimLengths();
+	}
+}
+
+void ABSWeapon::CacheAnimLengths()
+{
+	EquipAnim.CacheLengths();
+	UnequipAnim.CacheLengths();
+	FireAnim.CacheLengths();
+	ReloadAnim.CacheLengths();
+}
+#endif
+
+void ABSWeapon::PreloadCosmeticAssets()
+{
+	if (bCosmeticAssetsRequested || GetNetMode() == NM_DedicatedServer)
+		return;
+
+	UBSGameInstance* const GameInstance = Cast<UBSGameInstance>(GetGameInstance());
+	if (!GameInstance)
+		return;
+
+	bCosmeticAssetsRequested = true;
+
+	TArray<FStringAssetReference> AssetsToLoad;
+	auto AddAsset = [&AssetsToLoad](const FStringAssetReference& AssetRef)
+	{
+		if (AssetRef.IsValid())
+		{
+			AssetsToLoad.AddUnique(AssetRef);
+		}
+	};
+
+	AddAsset(FireSound.ToStringReference());
+	AddAsset(EndFireSound.ToStringReference());
+	AddAsset(EmptyClipSound.ToStringReference());
+	AddAsset(MuzzleFX.ToStringReference());
+	AddAsset(FireCameraShake.ToStringReference());
+
+	for (const FWeaponAnim* WeaponAnim : { &EquipAnim, &UnequipAnim, &FireAnim, &ReloadAnim })
+	{
+		AddAsset(WeaponAnim->FirstPerson.ToStringReference());
+		AddAsset(WeaponAnim->ThirdPerson.ToStringReference());
+	}
+
+	GameInstance->GetStreamableManager().RequestAsyncLoad(AssetsToLoad, FStreamableDelegate::CreateUObject(this, &ABSWeapon::OnCosmeticAssetsLoaded));
+}
+
+void ABSWeapon::OnCosmeticAssetsLoaded()
+{
+	LoadedCosmeticAssets.Reset();
+
+	auto AddLoaded = [this](UObject* Asset)
+	{
+		if (Asset)
+		{
+			LoadedCosmeticAssets.AddUnique(Asset);
+		}
+	};
+
+	AddLoaded(FireSound.Get());
+	AddLoaded(EndFireSound.Get());
+	AddLoaded(EmptyClipSound.Get());
+	AddLoaded(MuzzleFX.Get());
+	AddLoaded(FireCameraShake.Get());
+
+	for (const FWeaponAnim* WeaponAnim : { &EquipAnim, &UnequipAnim, &FireAnim, &ReloadAnim })
+	{
+		AddLoaded(WeaponAnim->FirstPerson.Get());
+		AddLoaded(WeaponAnim->ThirdPerson.Get());
+	}
+}
+
 void ABSWeapon::SetOwner(AActor* NewOwner)
 {
 	Super::SetOwner(NewOwner);
@@ -103,12 +241,21 @@ void ABSWeapon::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetim
 	DOREPLIFETIME_CONDITION(ABSWeapon, bServerFired, COND_SkipOwner);
 	DOREPLIFETIME_CONDITION(ABSWeapon, WeaponState, COND_SkipOwner);
 	DOREPLIFETIME_CONDITION(ABSWeapon, ShotType, COND_InitialOnly);
+	DOREPLIFETIME_CONDITION(ABSWeapon, SpreadSeed, COND_OwnerOnly);
+	DOREPLIFETIME(ABSWeapon, Attachments);
+	DOREPLIFETIME_CONDITION(ABSWeapon, ServerBurstIndex, COND_SkipOwner);
 }
 
 // Called when the game starts or when spawned
 void ABSWeapon::BeginPlay()
 {
 	Super::BeginPlay();
+
+	// Clients begin play once the initial attachments have replicated, so ammo is filled from the same stats everywhere
+	RemainingClip = FMath::Min(CompiledStats.ClipSize, CompiledStats.MaxAmmo);
+	RemainingAmmo = FMath::Max(CompiledStats.MaxAmmo - RemainingClip, 0);
+
+	UpdateNetDormancy();
 }
 
 // Called every frame
@@ -116,22 +263,32 @@ void ABSWeapon::Tick( float DeltaTime )
 {
 	Super::Tick( DeltaTime );
 
-	if (CurrentRecoilSpread > 0.f)
+	if (bFireScheduleActive)
 	{
-		// Reduce recoil spread
-		CurrentRecoilSpread = FMath::Max(0.f, CurrentRecoilSpread - WeaponStats.Stability * DeltaTime);
+		UpdateFireSchedule(DeltaTime);
 	}
 	
 	if (CurrentRecoilOffset.GetAbsMax() > DELTA)
 	{
 		// Lerp recoil offset to zero
-		const FVector2D NewRecoilOffset = FMath::Lerp(CurrentRecoilOffset, FVector2D::ZeroVector, DeltaTime * WeaponStats.Stability);
+		const FVector2D NewRecoilOffset = FMath::Lerp(CurrentRecoilOffset, FVector2D::ZeroVector, FMath::Min(DeltaTime * CompiledStats.Stability, 1.f));
 
-		BSCharacter->AddControllerPitchInput(CurrentRecoilOffset.Y - NewRecoilOffset.Y);
-		BSCharacter->AddControllerYawInput(NewRecoilOffset.X - CurrentRecoilOffset.X);
+		if (BSCharacter)
+		{
+			BSCharacter->AddControllerPitchInput(CurrentRecoilOffset.Y - NewRecoilOffset.Y);
+			BSCharacter->AddControllerYawInput(NewRecoilOffset.X - CurrentRecoilOffset.X);
+		}
 
 		CurrentRecoilOffset = NewRecoilOffset;
 	}
+
+	UpdateTickEnabled();
+}
+
+void ABSWeapon::UpdateTickEnabled()
+{
+	const bool bRecoveringRecoil = CurrentRecoilOffset.GetAbsMax() > DELTA;
+	SetActorTickEnabled(bFireScheduleActive || bRecoveringRecoil);
 }
 
 void ABSWeapon::AttachToOwner()
@@ -144,6 +301,12 @@ void ABSWeapon::AttachToOwner()
 		const FName AttachSocket = BSCharacter->GetWeaponEquippedSocket();
 
 		USkeletalMeshComponent* const ActiveMesh = GetActiveMesh();
+
+		if (!ActiveMesh->IsRegistered())
+		{
+			ActiveMesh->RegisterComponent();
+		}
+
 		ActiveMesh->AttachToComponent(BSCharacter->GetActiveMesh(), FAttachmentTransformRules::SnapToTargetNotIncludingScale, AttachSocket);
 		ActiveMesh->SetHiddenInGame(false);
 	}
@@ -156,8 +319,11 @@ void ABSWeapon::AttachToOwner()
 
 void ABSWeapon::DetachFromOwner()
 {
-	MeshFP->DetachFromComponent(FDetachmentTransformRules::KeepWorldTransform);
-	MeshFP->SetHiddenInGame(true);
+	if (MeshFP)
+	{
+		MeshFP->DetachFromComponent(FDetachmentTransformRules::KeepWorldTransform);
+		MeshFP->SetHiddenInGame(true);
+	}
 
 	MeshTP->DetachFromComponent(FDetachmentTransformRules::KeepWorldTransform);
 	MeshTP->SetHiddenInGame(true);
@@ -188,33 +354,97 @@ void ABSWeapon::StopFire()
 }
 
 float ABSWeapon::GetCurrentSpread() const
+{
+	return GetSpreadAt(GetWorld()->GetTimeSeconds());
+}
+
+float ABSWeapon::GetSpreadAt(const float Time) const
 {
 	// Get spread factor based on movement
 	const float MovementFactor = BSCharacter->GetVelocity().Size() / BSCharacter->GetMovementComponent()->GetMaxSpeed();
-	const float MovementSpread = MovementFactor * WeaponStats.MovingSpreadIncrement;
+	const float MovementSpread = MovementFactor * CompiledStats.MovingSpreadIncrement;
 
 	// Get spread factor based on crouch/standing
-	const float StandingSpread = BSCharacter->bIsCrouched ? 0.f : WeaponStats.StandingSpreadIncrement;
+	const float StandingSpread = BSCharacter->bIsCrouched ? 0.f : CompiledStats.StandingSpreadIncrement;
+
+	return CompiledStats.BaseSpread + MovementSpread + StandingSpread + GetRecoilSpreadAt(Time);
+}
 
-	return WeaponStats.BaseSpread + MovementSpread + StandingSpread + CurrentRecoilSpread;
+FVector2D ABSWeapon::GetRecoilKick(const uint8 BurstIndex) const
+{
+	return RecoilPattern.Num() == RECOIL_PATTERN_LENGTH ? RecoilPattern[BurstIndex & (RECOIL_PATTERN_LENGTH - 1)] : FVector2D::ZeroVector;
+}
+
+float ABSWeapon::GetRecoilSpread() const
+{
+	return GetRecoilSpreadAt(GetWorld()->GetTimeSeconds());
 }
 
-UAnimMontage* ABSWeapon::GetWeaponMontage(const FWeaponAnim& WeaponAnim)
+float ABSWeapon::GetRecoilSpreadAt(const float Time) const
 {
-	return (BSCharacter->IsFirstPerson()) ? WeaponAnim.FirstPerson : WeaponAnim.ThirdPerson;
+	// Recoil spread recovers linearly since the last shot
+	const float TimeSinceShot = FMath::Max(0.f, Time - LastRecoilTime);
+	return FMath::Max(0.f, RecoilSpreadAtLastShot - CompiledStats.Stability * TimeSinceShot);
+}
+
+void ABSWeapon::AddRecoilSpread(const float ShotTime)
+{
+	RecoilSpreadAtLastShot = GetRecoilSpreadAt(ShotTime) + CompiledStats.RecoilSpreadIncrement;
+	LastRecoilTime = ShotTime;
+}
+
+float ABSWeapon::GetServerShotTime(const float MoveTimeStamp, const float ArrivalShotTime) const
+{
+	if (!bHasServerShotTime)
+	{
+		return ArrivalShotTime;
+	}
+
+	// A negative delta after a client timestamp reset is spaced by the fire interval
+	const float ClientDelta = MoveTimeStamp - LastServerShotTimeStamp;
+	return FMath::Max(LastServerShotTime + CompiledStats.FireRate, FMath::Min(LastServerShotTime + ClientDelta, ArrivalShotTime));
+}
+
+FRandomStream ABSWeapon::GetShotRandomStream(const uint16 ShotIndex) const
+{
+	return FRandomStream(HashCombine(static_cast<uint32>(SpreadSeed), static_cast<uint32>(ShotIndex)));
+}
+
+void ABSWeapon::ApplyShotSpread(FShotData& ShotData) const
+{
+	// Quantize first so the server rebuilds the exact direction from replicated values
+	ShotData.Quantize();
+
+	FRandomStream SpreadStream = GetShotRandomStream(ShotData.ShotIndex);
+	const float SpreadRadians = FMath::DegreesToRadians(ShotData.Spread);
+
+	ShotData.Direction = SpreadStream.VRandCone(ShotData.AimRotation.Vector(), SpreadRadians);
+}
+
+UAnimMontage* ABSWeapon::GetWeaponMontage(const FWeaponAnim& WeaponAnim) const
+{
+	return (BSCharacter->IsFirstPerson()) ? WeaponAnim.FirstPerson.Get() : WeaponAnim.ThirdPerson.Get();
+}
+
+float ABSWeapon::GetTransitionLength(const FWeaponAnim& WeaponAnim) const
+{
+	// Player controlled characters play the first person montage on their owner
+	return (BSCharacter && BSCharacter->IsPlayerControlled()) ? WeaponAnim.FirstPersonLength : WeaponAnim.ThirdPersonLength;
 }
 
 void ABSWeapon::PlayFiringSequence()
 {
-	if (MuzzleFX && (!MuzzleFX->IsLooping() || !MuzzleFXComponent))
+	UParticleSystem* const MuzzleFXTemplate = MuzzleFX.Get();
+	if (MuzzleFXTemplate && (!MuzzleFXTemplate->IsLooping() || !MuzzleFXComponent))
 	{
-		MuzzleFXComponent = UGameplayStatics::SpawnEmitterAttached(MuzzleFX, GetActiveMesh(), MuzzleSocket);
+		MuzzleFXComponent = UGameplayStatics::SpawnEmitterAttached(MuzzleFXTemplate, GetActiveMesh(), MuzzleSocket);
 		MuzzleFXComponent->Activate();			
 	}
 
-	if (FireSound && (!FireSound->IsLooping() || !FireSoundComponent))
+	USoundBase* const FireSoundAsset = FireSound.Get();
+	if (FireSoundAsset && (!FireSoundAsset->IsLooping() || !FireSoundComponent))
 	{
-		FireSoundComponent = UGameplayStatics::SpawnSoundAttached(FireSound, GetActiveMesh(), MuzzleSocket);
+		FireSoundComponent = UGameplayStatics::SpawnSoundAttached(FireSoundAsset, GetActiveMesh(), MuzzleSocket);
 		FireSoundComponent->Play();
 	}
 
@@ -223,13 +453,14 @@ void ABSWeapon::PlayFiringSequence()
 		BSCharacter->PlayAnimMontage(FireMontage);
 	}
 
-	if (FireCameraShake &&
+	const TSubclassOf<UCameraShake> CameraShake = FireCameraShake.Get();
+	if (CameraShake &&
 		BSCharacter->IsFirstPerson() &&
 		BSCharacter->IsLocallyControlled())
 	{
 		if (APlayerController* const PlayerController = Cast<APlayerController>(BSCharacter->GetController()))
 		{
-			PlayerController->ClientPlayCameraShake(FireCameraShake);
+			PlayerController->ClientPlayCameraShake(CameraShake);
 		}		
 	}
 }
@@ -272,29 +503,19 @@ void ABSWeapon::SetWeaponState(EWeaponState NewState)
 			// Set state locally
 			PrevWeaponState = WeaponState;
 			WeaponState = NewState;
+			UpdateNetDormancy();
 			OnNewWeaponState();
 
-			if (GetNetConnection()) // Make sure we have a net connection. This may not be the case when initial replication occurs.
+			// The server follows the transition from the weapon input sent with the owner's next move.
+			// Shots fired before the transition must reach the server first.
+			if (!HasAuthority() && GetNetConnection())
 			{
-				// Make sure the transition is sent to the server
-				ServerSetWeaponState(NewState);
-			}			
+				FlushShots();
+			}
 		}			
 	}
 }
 
-void ABSWeapon::ServerSetWeaponState_Implementation(const EWeaponState NewState)
-{
-	WeaponState = NewState;
-
-	OnNewWeaponState();
-}
-
-bool ABSWeapon::ServerSetWeaponState_Validate(const EWeaponState State)
-{
-	return true;
-}
-
 void ABSWeapon::OnNewWeaponState()
 {
 	if (PrevWeaponState == EWeaponState::Firing)
@@ -331,14 +552,16 @@ void ABSWeapon::OnEquipTransitionStart()
 {
 	OnEnteredEquippingState();
 
-	float TransitionTime = 0.f;
-	if (UAnimMontage* const Montage = GetWeaponMontage(EquipAnim))
-	{
-		TransitionTime = Montage->GetPlayLength();
-	}
+	// Cached length, so the server and clients time the transition the same without loading the montage
+	const float TransitionTime = GetTransitionLength(EquipAnim);
 
 	FTimerManager& TimerManager = GetWorld()->GetTimerManager();
 	TimerManager.ClearTimer(WeaponStateTimer);
+
+	if (HasAuthority())
+	{
+		TransitionTimeStamp = GetServerMoveTimeStamp();
+	}
 	
 	if (TransitionTime > 0.f)
 	{
@@ -361,10 +584,20 @@ void ABSWeapon::OnReloadTransitionStart()
 
 	FTimerManager& TimerManager = GetWorld()->GetTimerManager();
 	TimerManager.ClearTimer(WeaponStateTimer);
+
+	if (HasAuthority())
+	{
+		TransitionTimeStamp = GetServerMoveTimeStamp();
+	}
+	else if (BSCharacter && BSCharacter->IsLocallyControlled())
+	{
+		// The server starts the reload from the toggle sent with the next move
+		BSCharacter->ToggleReloadInput();
+	}
 	
-	if (WeaponStats.ReloadSpeed > 0.f)
+	if (CompiledStats.ReloadSpeed > 0.f)
 	{
-		TimerManager.SetTimer(WeaponStateTimer, this, &ABSWeapon::OnReloadTransitionExit, WeaponStats.ReloadSpeed);
+		TimerManager.SetTimer(WeaponStateTimer, this, &ABSWeapon::OnReloadTransitionExit, CompiledStats.ReloadSpeed);
 	}
 	else
 	{
@@ -375,7 +608,7 @@ void ABSWeapon::OnReloadTransitionStart()
 void ABSWeapon::OnReloadTransitionExit()
 {
 	// Update clip and ammo
-	const int32 EmptySlots = WeaponStats.ClipSize - RemainingClip;
+	const int32 EmptySlots = CompiledStats.ClipSize - RemainingClip;
 	const int32 RefillCount = FMath::Min(RemainingAmmo, EmptySlots);
 	RemainingClip += RefillCount;
 	RemainingAmmo -= RefillCount;
@@ -387,11 +620,8 @@ void ABSWeapon::OnUnequipTransitionStart()
 {
 	OnEnteredUnequippingState();
 
-	float TransitionTime = 0.f;
-	if (UAnimMontage* const Montage = GetWeaponMontage(UnequipAnim))
-	{
-		TransitionTime = Montage->GetPlayLength();
-	}
+	// Cached length, so the server and clients time the transition the same without loading the montage
+	const float TransitionTime = GetTransitionLength(UnequipAnim);
 
 	FTimerManager& TimerManager = GetWorld()->GetTimerManager();
 	TimerManager.ClearTimer(WeaponStateTimer);
@@ -411,7 +641,83 @@ void ABSWeapon::OnUnequipTransitionExit()
 	SetWeaponState(EWeaponState::Inactive);
 }
 
-void ABSWeapon::FireShot()
+void ABSWeapon::FinishTransition()
+{
+	if (WeaponState == EWeaponState::Equipping)
+	{
+		GetWorldTimerManager().ClearTimer(WeaponStateTimer);
+		OnEquipTransitionExit();
+	}
+	else if (WeaponState == EWeaponState::Reloading)
+	{
+		GetWorldTimerManager().ClearTimer(WeaponStateTimer);
+		OnReloadTransitionExit();
+	}
+}
+
+void ABSWeapon::CatchUpTransition(const float MoveTimeStamp)
+{
+	if (WeaponState != EWeaponState::Equipping && WeaponState != EWeaponState::Reloading)
+		return;
+
+	// Don't trust a timestamp far ahead of the moves the server has received
+	const float ClampedTimeStamp = FMath::Min(MoveTimeStamp, GetServerMoveTimeStamp() + MAX_SHOT_TIMESTAMP_LEAD);
+
+	float TimeSinceStart = ClampedTimeStamp - TransitionTimeStamp;
+
+	if (TimeSinceStart < 0.f)
+	{
+		// The client reset its timestamps since the transition started. Only the time since the reset is known.
+		TimeSinceStart = ClampedTimeStamp;
+	}
+
+	const float TransitionLength = (WeaponState == EWeaponState::Reloading) ? CompiledStats.ReloadSpeed : GetTransitionLength(EquipAnim);
+
+	if (TimeSinceStart >= TransitionLength - TRANSITION_TIMESTAMP_TOLERANCE)
+	{
+		FinishTransition();
+	}
+}
+
+float ABSWeapon::GetServerMoveTimeStamp() const
+{
+	const UBSCharacterMovementComponent* const Movement = BSCharacter ? Cast<UBSCharacterMovementComponent>(BSCharacter->GetCharacterMovement()) : nullptr;
+	return Movement ? Movement->GetServerMoveTimeStamp() : 0.f;
+}
+
+void ABSWeapon::UpdateFireSchedule(const float DeltaTime)
+{
+	const float CurrentTime = GetWorld()->GetTimeSeconds();
+	const float FrameStartTime = CurrentTime - DeltaTime;
+	const FRotator CurrentAimRotation = GetAimRotation();
+	const FRotator AimDelta = (CurrentAimRotation - PrevAimRotation).GetNormalized();
+
+	int32 ShotCount = 0;
+
+	while (bFireScheduleActive && WeaponState == EWeaponState::Firing && NextFireTime <= CurrentTime)
+	{
+		if (ShotCount == MAX_SHOTS_PER_FRAME)
+		{
+			NextFireTime = CurrentTime;
+			break;
+		}
+
+		const float Alpha = (DeltaTime > 0.f) ? FMath::Clamp((NextFireTime - FrameStartTime) / DeltaTime, 0.f, 1.f) : 1.f;
+		FireShot(NextFireTime, PrevAimRotation + AimDelta * Alpha);
+
+		NextFireTime += CompiledStats.FireRate;
+		++ShotCount;
+
+		if (!CompiledStats.bIsAuto)
+		{
+			bFireScheduleActive = false;
+		}
+	}
+
+	PrevAimRotation = CurrentAimRotation;
+}
+
+void ABSWeapon::FireShot(const float ShotTime, const FRotator& AimRotation)
 {
 	if (CanFire())
 	{
@@ -422,13 +728,20 @@ void ABSWeapon::FireShot()
 		else
 		{
 			FShotData ShotData;
+			ShotData.ShotIndex = NextShotIndex;
+			ShotData.BurstIndex = NextBurstIndex;
+			ShotData.AimRotation = AimRotation;
+
 			if (ShotType->GetShotData(ShotData))
 			{
+				++NextShotIndex;
+				++NextBurstIndex;
+
 				ShotType->PreInvokeShot(ShotData);
 
-				InvokeShot(ShotData);				
+				InvokeShot(ShotData, ShotTime);
 
-				LastFireTime = GetWorld()->GetTimeSeconds();
+				LastFireTime = ShotTime;
 			}
 		}
 	}
@@ -443,12 +756,12 @@ void ABSWeapon::FireShot()
 	}
 }
 
-void ABSWeapon::InvokeShot(const FShotData& ShotData)
+void ABSWeapon::InvokeShot(const FShotData& ShotData, const float ShotTime)
 {
 	if (!HasAuthority())
 	{
-		ServerInvokeShot(ShotData);
-		OnShotFired();
+		QueueShot(ShotData, ShotTime);
+		OnShotFired(ShotData.BurstIndex, ShotTime);
 		--RemainingClip;
 	}
 	else
@@ -460,37 +773,158 @@ void ABSWeapon::InvokeShot(const FShotData& ShotData)
 
 			--RemainingClip;
 
+			ServerBurstIndex = ShotData.BurstIndex;
 			bServerFired = !bServerFired;
 
 			if (GetNetMode() != NM_DedicatedServer)
-				OnRep_ServerFired();
+			{
+				// Same as OnRep_ServerFired, with the time the shot was fired at
+				if (WeaponState == EWeaponState::Firing)
+					OnShotFired(ShotData.BurstIndex, ShotTime);
+			}
+			else
+			{
+				// Track recoil so the server knows the minimum spread of the next shot
+				AddRecoilSpread(ShotTime);
+			}
 		}
 	}
 }
 
-void ABSWeapon::OnShotFired()
+void ABSWeapon::QueueShot(const FShotData& ShotData, const float ShotTime)
+{
+	PendingShots.Add(ShotData, ShotTime);
+
+	if (PendingShots.IsFull())
+	{
+		FlushShots();
+	}
+	else if (PendingShots.Num() == 1)
+	{
+		// First shot of a new batch. Send it along with any other shots fired this frame.
+		GetWorldTimerManager().SetTimerForNextTick(this, &ABSWeapon::FlushShots);
+	}
+}
+
+void ABSWeapon::SetAttachment(UBSWeaponAttachment* Attachment)
+{
+	if (!HasAuthority() || !Attachment)
+		return;
+
+	Attachments.RemoveAll([Attachment](const UBSWeaponAttachment* Existing) { return !Existing || Existing->Slot == Attachment->Slot; });
+	Attachments.Add(Attachment);
+
+	// Holstered weapons are dormant, make sure the change still replicates
+	FlushNetDormancy();
+
+	CompileStats();
+}
+
+void ABSWeapon::RemoveAttachment(EWeaponAttachmentSlot Slot)
+{
+	if (!HasAuthority())
+		return;
+
+	if (Attachments.RemoveAll([Slot](const UBSWeaponAttachment* Existing) { return !Existing || Existing->Slot == Slot; }) > 0)
+	{
+		FlushNetDormancy();
+
+		CompileStats();
+	}
+}
+
+void ABSWeapon::OnRep_Attachments()
+{
+	CompileStats();
+}
+
+void ABSWeapon::CompileStats()
+{
+	FWeaponStatModifierTotals Totals;
+	for (const UBSWeaponAttachment* const Attachment : Attachments)
+	{
+		if (Attachment)
+		{
+			Totals.Accumulate(*Attachment);
+		}
+	}
+
+	CompiledStats = WeaponStats;
+	CompiledStats.MaxAmmo = FMath::Max(FMath::RoundToInt(Totals.Apply(EWeaponStat::MaxAmmo, WeaponStats.MaxAmmo)), 0);
+	CompiledStats.ClipSize = FMath::Max(FMath::RoundToInt(Totals.Apply(EWeaponStat::ClipSize, WeaponStats.ClipSize)), 1);
+	CompiledStats.BaseDamage = FMath::Max(Totals.Apply(EWeaponStat::BaseDamage, WeaponStats.BaseDamage), 0.f);
+	CompiledStats.FireRate = FMath::Max(Totals.Apply(EWeaponStat::FireRate, WeaponStats.FireRate), KINDA_SMALL_NUMBER);
+	CompiledStats.ReloadSpeed = FMath::Max(Totals.Apply(EWeaponStat::ReloadSpeed, WeaponStats.ReloadSpeed), 0.f);
+	CompiledStats.Stability = FMath::Max(Totals.Apply(EWeaponStat::Stability, WeaponStats.Stability), 0.f);
+	CompiledStats.BaseSpread = FMath::Clamp(Totals.Apply(EWeaponStat::BaseSpread, WeaponStats.BaseSpread), 0.f, 45.f);
+	CompiledStats.StandingSpreadIncrement = FMath::Clamp(Totals.Apply(EWeaponStat::StandingSpreadIncrement, WeaponStats.StandingSpreadIncrement), 0.f, 45.f);
+	CompiledStats.MovingSpreadIncrement = FMath::Clamp(Totals.Apply(EWeaponStat::MovingSpreadIncrement, WeaponStats.MovingSpreadIncrement), 0.f, 45.f);
+	CompiledStats.RecoilSpreadIncrement = FMath::Clamp(Totals.Apply(EWeaponStat::RecoilSpreadIncrement, WeaponStats.RecoilSpreadIncrement), 0.f, 45.f);
+	CompiledStats.RecoilPushSpread = FMath::Max(Totals.Apply(EWeaponStat::RecoilPushSpread, WeaponStats.RecoilPushSpread), 0.f);
+
+	// Bake the recoil pattern. Seeded from the class name, so every machine bakes the same pattern.
+	FRandomStream RecoilStream(FCrc::StrCrc32(*GetClass()->GetName()));
+	RecoilPattern.SetNumUninitialized(RECOIL_PATTERN_LENGTH);
+	for (int32 i = 0; i < RECOIL_PATTERN_LENGTH; ++i)
+	{
+		// Rotate RecoilPush by up to RecoilPushSpread either way
+		const float Rotation = RecoilStream.FRandRange(-1.f, 1.f) * CompiledStats.RecoilPushSpread;
+		RecoilPattern[i] = CompiledStats.RecoilPush.GetRotated(Rotation);
+	}
+
+	// A smaller magazine returns the excess rounds to the reserve
+	if (RemainingClip > CompiledStats.ClipSize)
+	{
+		RemainingAmmo += RemainingClip - CompiledStats.ClipSize;
+		RemainingClip = CompiledStats.ClipSize;
+	}
+}
+
+void ABSWeapon::UpdateNetDormancy()
+{
+	if (HasAuthority() && !bTearOff)
+	{
+		// Holstered weapons have nothing to replicate. Going dormant sends the final state before closing the channel.
+		const ENetDormancy NewDormancy = (WeaponState == EWeaponState::Inactive) ? DORM_DormantAll : DORM_Awake;
+
+		if (NetDormancy != NewDormancy)
+		{
+			SetNetDormancy(NewDormancy);
+		}
+	}
+}
+
+void ABSWeapon::FlushShots()
+{
+	if (PendingShots.Num() > 0)
+	{
+		// Stamp the batch with the move its last shot was fired during
+		const UBSCharacterMovementComponent* const Movement = BSCharacter ? Cast<UBSCharacterMovementComponent>(BSCharacter->GetCharacterMovement()) : nullptr;
+		const float TimeSinceLast = GetWorld()->GetTimeSeconds() - PendingShots.ShotTimes.Last();
+		PendingShots.MoveTimeStamp = Movement ? Movement->GetClientMoveTimeStamp() - TimeSinceLast : 0.f;
+
+		ServerInvokeShots(PendingShots);
+		PendingShots.Reset();
+	}
+}
+
+void ABSWeapon::OnShotFired(const uint8 BurstIndex, const float ShotTime)
 {
 	PlayFiringSequence();
 
-	CurrentRecoilSpread += WeaponStats.RecoilSpreadIncrement;
+	AddRecoilSpread(ShotTime);
+
+	LastRecoilKick = GetRecoilKick(BurstIndex);
 
 	if (BSCharacter->IsLocallyControlled())
 	{
 		// Only apply recoil to player if locally controlled. Replicated
 		// view direction will allow this to replicate to all clients.		
-		const int32 Seed = FMath::Rand();
-		FRandomStream RecoilOffsetStream(Seed);
+		BSCharacter->AddControllerPitchInput(-LastRecoilKick.Y);
+		BSCharacter->AddControllerYawInput(LastRecoilKick.X);
 
-		// Get random rotation [-1, 1] to factor in with RecoilPushSpread and
-		// apply the rotation to RecoilPush
-		const float RSeed = 2.f * FMath::FRand() - 1.f;
-		const float Rotation = RSeed * WeaponStats.RecoilPushSpread;
-		const FVector2D RecoilInput = WeaponStats.RecoilPush.GetRotated(Rotation);
-
-		BSCharacter->AddControllerPitchInput(-RecoilInput.Y);
-		BSCharacter->AddControllerYawInput(RecoilInput.X);
-
-		CurrentRecoilOffset += RecoilInput;
+		CurrentRecoilOffset += LastRecoilKick;
+		UpdateTickEnabled();
 	}
 }
 
@@ -498,36 +932,38 @@ void ABSWeapon::OnEnteredFiringState()
 {
 	if (BSCharacter->IsLocallyControlled())
 	{
-		// Use delay to prevent tap firing faster than the fire rate of the weapon.
-		const float CurrentTime = GetWorld()->GetTimeSeconds();
-		const float ShotDelay = FMath::Max(0.f, WeaponStats.FireRate - (CurrentTime - LastFireTime));
-
-		GetWorldTimerManager().SetTimer(WeaponFiringTimer, this, &ABSWeapon::FireShot, WeaponStats.FireRate, WeaponStats.bIsAuto, ShotDelay);
+		// Each burst starts from the beginning of the recoil pattern
+		NextBurstIndex = 0;
+
+		// Delay the first shot to prevent tap firing faster than the fire rate of the weapon.
+		// Shots are fired from Tick so state transitions are never nested.
+		NextFireTime = FMath::Max(GetWorld()->GetTimeSeconds(), LastFireTime + CompiledStats.FireRate);
+		PrevAimRotation = GetAimRotation();
+		bFireScheduleActive = true;
+		UpdateTickEnabled();
 	}
 }
 
 void ABSWeapon::OnExitFiringState()
 {
-	if (WeaponFiringTimer.IsValid())
-	{
-		GetWorldTimerManager().ClearTimer(WeaponFiringTimer);
-	}
+	bFireScheduleActive = false;
+	UpdateTickEnabled();
 
-	if (MuzzleFXComponent && MuzzleFX->IsLooping())
+	if (MuzzleFXComponent && MuzzleFXComponent->Template && MuzzleFXComponent->Template->IsLooping())
 	{
 		MuzzleFXComponent->DeactivateSystem();
 		MuzzleFXComponent = nullptr;
 	}
 
-	if (FireSoundComponent && FireSound->IsLooping())
+	if (FireSoundComponent && FireSoundComponent->Sound && FireSoundComponent->Sound->IsLooping())
 	{
 		FireSoundComponent->FadeOut(0.1f, 0.0f);
 		FireSoundComponent = nullptr;
 	}
 
-	if (EndFireSound)
+	if (USoundBase* const EndFireSoundAsset = EndFireSound.Get())
 	{
-		UGameplayStatics::SpawnSoundAttached(EndFireSound, RootComponent);
+		UGameplayStatics::SpawnSoundAttached(EndFireSoundAsset, RootComponent);
 	}
 }
 
@@ -562,30 +998,84 @@ void ABSWeapon::OnRep_Owner()
 	Super::OnRep_Owner();
 
 	BSCharacter = Cast<ABSCharacter>(GetOwner());
-
-	if (GetNetConnection())
-	{
-		// We may have changed weapon state before the owner replicated and NetRole updated.
-		// So make sure the server gets our current state.
-		ServerSetWeaponState(WeaponState);
-	}
 }
 
-void ABSWeapon::ServerInvokeShot_Implementation(const FShotData& ShotData)
+void ABSWeapon::ServerInvokeShots_Implementation(const FShotBatch& ShotBatch)
 {
-	InvokeShot(ShotData);
+	for (int32 i = 0; i < ShotBatch.Num(); ++i)
+	{
+		const FShotData& ShotData = ShotBatch.Shots[i];
+
+		const uint16 ExpectedShotIndex = LastServerShotIndex + 1;
+		const int16 SkippedShots = static_cast<int16>(ShotData.ShotIndex - ExpectedShotIndex);
+
+		// Ignore shots that have already been processed
+		if (SkippedShots < 0)
+		{
+			UE_LOG(BattleStage, Verbose, TEXT("ABSWeapon ignoring replayed shot %d"), ShotData.ShotIndex);
+			continue;
+		}
+
+		LastServerShotIndex = ShotData.ShotIndex;
+
+		// The owning client never skips a shot index. Skipping would let it pick favourable spread
+		// directions from the stream, so skipped shots and this one are spent without effect.
+		if (SkippedShots > 0)
+		{
+			UE_LOG(BattleStage, Warning, TEXT("ABSWeapon rejected shot %d, expected shot %d"), ShotData.ShotIndex, ExpectedShotIndex);
+			RemainingClip = FMath::Max(0, RemainingClip - (SkippedShots + 1));
+			continue;
+		}
+
+		const float MoveTimeStamp = ShotBatch.GetMoveTimeStamp(i);
+
+		// The owning client may have left Equipping or Reloading before the server did
+		CatchUpTransition(MoveTimeStamp);
+
+		const float TimeBeforeLast = ShotBatch.GetTimeBeforeLast(i);
+		const float ShotTime = GetWorld()->GetTimeSeconds() - TimeBeforeLast;
+
+		// Recoil is tracked on the client's shot timing, arrival times are skewed by jitter
+		const float RecoilTime = GetServerShotTime(MoveTimeStamp, ShotTime);
+		LastServerShotTime = RecoilTime;
+		LastServerShotTimeStamp = MoveTimeStamp;
+		bHasServerShotTime = true;
+
+		// Every shot type traces from the client's start on the server. A start away from the shooter,
+		// or behind a wall, would let the shot through it, so the shot is spent without effect.
+		if (BSCharacter && !FBSLagCompensation::IsShotStartValid(GetWorld(), *BSCharacter, ShotData.Start, ShotTime))
+		{
+			UE_LOG(BattleStage, Warning, TEXT("ABSWeapon rejected shot %d, start is too far from the shooter"), ShotData.ShotIndex);
+			RemainingClip = FMath::Max(0, RemainingClip - 1);
+			continue;
+		}
+
+		// Rebuild the shot direction from the replicated seed index instead of trusting the client.
+		// Spread can't be lower than the spread the server sees for the shot, less a tolerance.
+		const float MinSpread = FMath::Max(CompiledStats.BaseSpread, GetSpreadAt(RecoilTime) - SHOT_SPREAD_TOLERANCE);
+
+		FShotData ServerShotData = ShotData;
+		ServerShotData.Spread = FMath::Max(ShotData.Spread, MinSpread);
+		ApplyShotSpread(ServerShotData);
+
+		// The last shot in the batch was fired just before the batch was sent. Earlier shots
+		// are rewound further by how long before it they were fired.
+		ServerShotData.RewindTime = FBSLagCompensation::GetRewindTime(GetInstigatorController(), GetWorld(), TimeBeforeLast);
+
+		InvokeShot(ServerShotData, RecoilTime);
+	}
 }
 
-bool ABSWeapon::ServerInvokeShot_Validate(const FShotData& ShotData)
+bool ABSWeapon::ServerInvokeShots_Validate(const FShotBatch& ShotBatch)
 {
-	return true;
+	return ShotBatch.Num() <= MAX_SHOTS_PER_BATCH && ShotBatch.Shots.Num() == ShotBatch.ShotTimes.Num();
 }
 
 void ABSWeapon::PlayEmptyClipSequence()
 {
-	if (EmptyClipSound)
+	if (USoundBase* const EmptyClipSoundAsset = EmptyClipSound.Get())
 	{
-		UGameplayStatics::SpawnSoundAttached(EmptyClipSound, RootComponent);
+		UGameplayStatics::SpawnSoundAttached(EmptyClipSoundAsset, RootComponent);
 	}
 }
 
@@ -603,7 +1093,7 @@ bool ABSWeapon::CanReload() const
 {
 	if (WeaponState == EWeaponState::Firing || WeaponState == EWeaponState::Active || WeaponState == EWeaponState::Reloading)
 	{
-		return RemainingClip < WeaponStats.ClipSize && RemainingAmmo > 0;
+		return RemainingClip < CompiledStats.ClipSize && RemainingAmmo > 0;
 	}
 
 	return false;
@@ -621,7 +1111,7 @@ void ABSWeapon::OnRep_ServerFired()
 	// from replication order when ServerFired and WeaponState are changed
 	// at the same time.
 	if (WeaponState == EWeaponState::Firing)
-		OnShotFired();
+		OnShotFired(ServerBurstIndex, GetWorld()->GetTimeSeconds());
 }
 
 void ABSWeapon::OnRep_WeaponState()
@@ -723,9 +1213,9 @@ float ABSWeapon::PlayReloadSequence()
 {
 	if (UAnimMontage* ReloadMontage = GetWeaponMontage(ReloadAnim))
 	{
-		const float AnimLengthScale = ReloadMontage->CalculateSequenceLength() / WeaponStats.ReloadSpeed;
+		const float AnimLengthScale = ReloadMontage->CalculateSequenceLength() / CompiledStats.ReloadSpeed;
 		const float AnimLength = BSCharacter->PlayAnimMontage(ReloadMontage, AnimLengthScale);
 	}
 
-	return WeaponStats.ReloadSpeed;
+	return CompiledStats.ReloadSpeed;
 }
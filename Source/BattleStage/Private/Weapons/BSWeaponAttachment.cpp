@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BattleStage.h"
+#include "BSWeaponAttachment.h"
+
+FWeaponStatModifierTotals::FWeaponStatModifierTotals()
+{
+	for (int32 i = 0; i < (int32)EWeaponStat::Max; ++i)
+	{
+		Add[i] = 0.f;
+		Multiply[i] = 1.f;
+	}
+}
+
+void FWeaponStatModifierTotals::Accumulate(const UBSWeaponAttachment& Attachment)
+{
+	for (const FWeaponStatModifier& Modifier : Attachment.Modifiers)
+	{
+		if (Modifier.Stat < EWeaponStat::Max)
+		{
+			Add[(int32)Modifier.Stat] += Modifier.Add;
+			Multiply[(int32)Modifier.Stat] *= Modifier.Multiply;
+		}
+	}
+}
@@ -3,6 +3,7 @@
 #pragma once
 
 #include "Engine/GameInstance.h"
+#include "Engine/StreamableManager.h"
 #include "OnlineSessionInterface.h"
 #include "BSGameInstance.generated.h"
 
@@ -31,6 +32,9 @@ public:
 
 	void GracefullyDestroyOnlineSession();
 
+	/** Streams in assets that are referenced softly, such as weapon cosmetics. */
+	FStreamableManager& GetStreamableManager() { return StreamableManager; }
+
 	/** UGameInstance Interface Begin */
 	virtual bool JoinSession(ULocalPlayer* LocalPlayer, const FOnlineSessionSearchResult& SearchResult) override;
 	virtual bool JoinSession(ULocalPlayer* LocalPlayer, int32 SessionIndexInSearchResults) override;
@@ -66,6 +70,8 @@ private:
 
 	FOnCreateSessionCompleteDelegate OnContinueDestroyingOnlineSessionDelegate;
 
+	FStreamableManager StreamableManager;
+
 public:
 	TSubclassOf<class UBSMatchConfig> GetMatchConfigClass() const { return MatchConfigClass; }
 };
@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+DECLARE_STATS_GROUP(TEXT("BattleStage Effects"), STATGROUP_BSEffects, STATCAT_Advanced);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Tracers Played"), STAT_BSTracersPlayed, STATGROUP_BSEffects, BATTLESTAGE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Tracers Culled"), STAT_BSTracersCulled, STATGROUP_BSEffects, BATTLESTAGE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Impacts Played"), STAT_BSImpactsPlayed, STATGROUP_BSEffects, BATTLESTAGE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Impacts Culled (Distance)"), STAT_BSImpactsCulledDistance, STATGROUP_BSEffects, BATTLESTAGE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Impacts Culled (Budget)"), STAT_BSImpactsCulledBudget, STATGROUP_BSEffects, BATTLESTAGE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Impact Sounds Played"), STAT_BSImpactSoundsPlayed, STATGROUP_BSEffects, BATTLESTAGE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Impact Sounds Culled"), STAT_BSImpactSoundsCulled, STATGROUP_BSEffects, BATTLESTAGE_API);
+
+//-----------------------------------------------------------------
+// Number of effects played during a frame, limited by a budget
+//-----------------------------------------------------------------
+struct FBSEffectBudget
+{
+	uint64 Frame = 0;
+
+	int32 Used = 0;
+
+	/**
+	* Consumes one effect from the budget of a frame.
+	* @returns True if the effect is within budget.
+	*/
+	bool Consume(const uint64 InFrame, const int32 Budget)
+	{
+		if (Frame != InFrame)
+		{
+			Frame = InFrame;
+			Used = 0;
+		}
+
+		if (Used >= Budget)
+			return false;
+
+		++Used;
+		return true;
+	}
+};
+
+/**
+ * Level of detail policy for shot cosmetics on clients. Decides which tracers, impact effects
+ * and impact sounds are worth spawning for the local view, so gunfire far from the viewer
+ * costs next to nothing. Tuned with the bs.Tracer* and bs.Impact* console variables, and
+ * reported under "stat BSEffects".
+ *
+ * The policy only depends on the view location passed in, so bs.BenchEffectsLOD can run it
+ * without a viewport.
+ */
+struct BATTLESTAGE_API FBSEffectsLOD
+{
+	/**
+	* Gets the location cosmetics are played for, the view of the first local player.
+	* @returns False if the world has no local player, in which case nothing is relevant.
+	*/
+	static bool GetViewLocation(const UWorld* World, FVector& OutViewLocation);
+
+	/** If a tracer between two locations passes close enough to the view to be spawned. */
+	static bool IsTracerRelevant(const FVector& ViewLocation, const FVector& Start, const FVector& End);
+
+	/** If an impact is close enough to the view to spawn its particles and decal. */
+	static bool IsImpactRelevant(const FVector& ViewLocation, const FVector& ImpactLocation);
+
+	/**
+	* Consumes one impact effect from the per frame budget shared by every impact effect.
+	* @returns True if the impact is within budget.
+	*/
+	static bool ConsumeImpactBudget();
+
+	/**
+	* If a sound played at a location can be heard from the view.
+	*
+	* @param ViewLocation			The listening location.
+	* @param SoundLocation			Location the sound would be played at.
+	* @param MaxAudibleDistance		Distance the sound's attenuation fades out at.
+	*/
+	static bool IsSoundAudible(const FVector& ViewLocation, const FVector& SoundLocation, const float MaxAudibleDistance);
+
+	/** If a sound asset played at a location can be heard from the view. */
+	static bool IsSoundAudible(const FVector& ViewLocation, const FVector& SoundLocation, USoundBase* Sound);
+};
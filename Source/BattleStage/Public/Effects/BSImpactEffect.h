@@ -46,6 +46,25 @@ public:
 	UFUNCTION(BlueprintCallable, Category = ImpactEffect)
 	virtual void SpawnEffect(UWorld* World, const FHitResult& Hit) const;
 
+	/**
+	* Spawns the impact effect for a specific surface type, ignoring the physical
+	* material of the hit.
+	* 
+	* @param World			The world context.
+	* @param Hit			The hit impact to play to effect for.
+	* @param SurfaceType	The surface type to play the effect for.
+	*/
+	virtual void SpawnEffectForSurface(UWorld* World, const FHitResult& Hit, const EPhysicalSurface SurfaceType) const;
+
+	/**
+	* Spawns the impact effect for multiple hits, such as every surface a shot passed through.
+	* 
+	* @param World	The world context.
+	* @param Hits	The hit impacts to play the effect for.
+	*/
+	UFUNCTION(BlueprintCallable, Category = ImpactEffect)
+	virtual void SpawnEffects(UWorld* World, const TArray<FHitResult>& Hits) const;
+
 	//-----------------------------------------------------------------
 	// UObject Interface 
 	//-----------------------------------------------------------------
@@ -64,6 +83,6 @@ protected:
 	FMaterialEffect SurfaceEffects[SurfaceType_Max];
 
 private:
-	/** Gets the surface effect for the specified physical material */
-	const FMaterialEffect& GetEffect(TWeakObjectPtr<UPhysicalMaterial> Material) const;
+	/** Gets the effect for the specified surface type */
+	const FMaterialEffect& GetEffect(const EPhysicalSurface SurfaceType) const;
 };
@@ -0,0 +1,166 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "UObject.h"
+#include "BSImpactEffectPool.generated.h"
+
+//-----------------------------------------------------------------
+// Bookkeeping for one type of pooled component. Indices match the
+// component array the bookkeeping belongs to.
+//-----------------------------------------------------------------
+struct BATTLESTAGE_API FBSEffectPoolBookkeeping
+{
+	/** Template or sound each component is set up to play */
+	TArray<const UObject*> Templates;
+
+	/** Use counter value the last time each component was played */
+	TArray<uint32> LastUsed;
+
+	/** Indices of components, by template */
+	TMap<const UObject*, TArray<int32>> ComponentsByTemplate;
+
+	/** Increased every time a component is played, used to find the least recently used component */
+	uint32 UseCounter = 0;
+
+	int32 Num() const { return Templates.Num(); }
+
+	/** Adds a component at the next index for a template. */
+	void Add(const UObject* Template);
+
+	/** Moves the component at an index to a different template. */
+	void Rekey(const int32 Index, const UObject* Template);
+
+	/** Marks the component at an index as played now. */
+	void MarkUsed(const int32 Index) { LastUsed[Index] = ++UseCounter; }
+
+	/** Gets the index of the least recently used component. */
+	int32 FindLeastRecentlyUsed() const;
+
+	/**
+	* Finds a component to play a template with.
+	*
+	* @param Template		The template to play.
+	* @param MaxComponents	Hard cap of the component type. Always allows at least one component.
+	* @param IsFree			Checks if the component at an index has finished playing.
+	* @param OutIndex		Index of the component, or INDEX_NONE if a new component should be added.
+	* @returns True if the component at OutIndex was set up for a different template and has been stolen.
+	*/
+	template<typename IsFreeFunc>
+	bool FindComponent(const UObject* Template, const int32 MaxComponents, IsFreeFunc IsFree, int32& OutIndex);
+};
+
+template<typename IsFreeFunc>
+bool FBSEffectPoolBookkeeping::FindComponent(const UObject* Template, const int32 MaxComponents, IsFreeFunc IsFree, int32& OutIndex)
+{
+	const int32 Cap = FMath::Max(1, MaxComponents);
+
+	// Reuse a finished component already set up for the template
+	if (const TArray<int32>* const Indices = ComponentsByTemplate.Find(Template))
+	{
+		int32 OldestIndex = INDEX_NONE;
+
+		for (const int32 Index : *Indices)
+		{
+			if (IsFree(Index))
+			{
+				OutIndex = Index;
+				return false;
+			}
+
+			if (OldestIndex == INDEX_NONE || LastUsed[Index] < LastUsed[OldestIndex])
+			{
+				OldestIndex = Index;
+			}
+		}
+
+		// Pool is full, restarting the oldest component of the same template doesn't need a new template
+		if (Num() >= Cap && OldestIndex != INDEX_NONE)
+		{
+			OutIndex = OldestIndex;
+			return false;
+		}
+	}
+
+	if (Num() < Cap)
+	{
+		OutIndex = INDEX_NONE;
+		return false;
+	}
+
+	// Prefer a finished component of another template before stealing one that is still playing
+	int32 StealIndex = INDEX_NONE;
+
+	for (int32 Index = 0; Index < Num(); ++Index)
+	{
+		if (IsFree(Index))
+		{
+			StealIndex = Index;
+			break;
+		}
+	}
+
+	if (StealIndex == INDEX_NONE)
+	{
+		StealIndex = FindLeastRecentlyUsed();
+	}
+
+	Rekey(StealIndex, Template);
+
+	OutIndex = StealIndex;
+	return true;
+}
+
+/**
+ * Pools the particle and audio components used to play impact effects, so impacts reuse
+ * registered components instead of spawning, registering and destroying a component per hit.
+ *
+ * Created by ABSGameState on clients. Components are keyed by the particle system or sound
+ * they were set up for. A component is free to reuse once it has finished playing. Each pool
+ * has a hard cap, and when every component is busy the least recently used component is
+ * stolen and restarted for the new impact.
+ */
+UCLASS(Transient)
+class BATTLESTAGE_API UBSImpactEffectPool : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	/** Gets the impact effect pool of a world, if it has one. */
+	static UBSImpactEffectPool* Get(const UWorld* World);
+
+	/**
+	* Plays a particle system using a pooled component.
+	*
+	* @param Template		The particle system to play.
+	* @param Location		World location to play the particles at.
+	* @param Rotation		World rotation to play the particles with.
+	*/
+	void PlayParticles(UParticleSystem* Template, const FVector& Location, const FRotator& Rotation);
+
+	/**
+	* Plays a sound using a pooled component.
+	*
+	* @param Sound			The sound to play.
+	* @param Location		World location to play the sound at.
+	* @param Rotation		World rotation to play the sound with.
+	*/
+	void PlaySound(USoundBase* Sound, const FVector& Location, const FRotator& Rotation);
+
+	/** UObject Interface Begin */
+	virtual UWorld* GetWorld() const override;
+	/** UObject Interface End */
+
+private:
+	/** Pooled particle components, indexed by ParticleBookkeeping */
+	UPROPERTY()
+	TArray<UParticleSystemComponent*> ParticleComponents;
+
+	/** Pooled audio components, indexed by AudioBookkeeping */
+	UPROPERTY()
+	TArray<UAudioComponent*> AudioComponents;
+
+	FBSEffectPoolBookkeeping ParticleBookkeeping;
+
+	FBSEffectPoolBookkeeping AudioBookkeeping;
+};
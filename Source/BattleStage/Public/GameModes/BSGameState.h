@@ -6,6 +6,8 @@
 #include "BSGameState.generated.h"
 
 class ABSPlayerState;
+class ABSProjectileManager;
+class UBSImpactEffectPool;
 
 UENUM()
 enum class EScoreType : uint8
@@ -73,6 +75,12 @@ public:
 
 	UFUNCTION(BlueprintCallable, Category = GameState)
 	bool IsTeamGame() const { return bIsTeamGame; }
+
+	/** Get the manager that pools projectiles for every weapon */
+	ABSProjectileManager* GetProjectileManager() const { return ProjectileManager; }
+
+	/** Get the pool of impact effect components. Null on dedicated servers. */
+	UBSImpactEffectPool* GetImpactEffectPool() const { return ImpactEffectPool; }
 	
 	/**
 	* Called by local players to quit the current game and return to the main menu. 
@@ -87,6 +95,7 @@ public:
 	/** AGameState Interface End */
 
 	/** AActor Interface Begin */
+	virtual void PostInitializeComponents() override;
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 	/** AActor Interface End */
 
@@ -123,6 +132,17 @@ protected:
 	UPROPERTY(Transient, Replicated, BlueprintReadOnly, Category = GameState, meta = (AllowPrivateAccess = "true"))
 	uint32 bIsTeamGame : 1;
 
+	/** Class of the projectile manager spawned by the server */
+	UPROPERTY(EditDefaultsOnly, Category = GameState)
+	TSubclassOf<ABSProjectileManager> ProjectileManagerClass;
+
+	UPROPERTY(Transient, Replicated)
+	ABSProjectileManager* ProjectileManager;
+
+	/** Pooled components for impact effects. Not created on dedicated servers. */
+	UPROPERTY(Transient)
+	UBSImpactEffectPool* ImpactEffectPool = nullptr;
+
 	/** The last score event that was received */
 	UPROPERTY(ReplicatedUsing = OnRecievedScoreEvent)
 	FScoreEvent LastScoreEvent;
@@ -1,6 +1,7 @@
 // Copyright 1998-2015 Epic Games, Inc. All Rights Reserved.
 #pragma once
 #include "GameFramework/Character.h"
+#include "BSLagCompensation.h"
 #include "BSCharacter.generated.h"
 
 class UInputComponent;
@@ -92,6 +93,9 @@ public:
 	/** Gets info describing the last received damage hit on this character. */
 	const FReceiveHitInfo& GetLastHitInfo() const;
 
+	/** Server only. Gets the recorded hitbox history used for lag compensation. */
+	const FBSHitboxHistory& GetHitboxHistory() const { return HitboxHistory; }
+
 	/**
 	* Returns the dominate mesh used for this character. Will be the first person mesh
 	* for first person characters, otherwise it will be the third person mesh.
@@ -116,6 +120,27 @@ public:
 	UFUNCTION(BlueprintCallable, Category = Inventory)
 	void SwapWeapon();
 
+	/**
+	* Server only.
+	* Applies the weapon input of the owning client, received with each of its moves. Runs
+	* the weapon state machine to match the client's equipped weapon.
+	*
+	* @param bTriggerHeld		If the client's equipped weapon is firing.
+	* @param bReloadToggle		Flipped by the client every time its equipped weapon starts reloading.
+	* @param WeaponSlot			The client's active weapon slot.
+	* @param MoveTimeStamp		Client timestamp of the move the input was sent with.
+	*/
+	void ApplyWeaponInput(const bool bTriggerHeld, const bool bReloadToggle, const EWeaponSlot WeaponSlot, const float MoveTimeStamp);
+
+	/**
+	* Owning client only.
+	* Called when the equipped weapon starts reloading. Flips the reload toggle sent with
+	* the following moves, so the server starts the reload once instead of every move.
+	*/
+	void ToggleReloadInput();
+
+	FORCEINLINE bool GetReloadInputToggle() const { return bReloadInputToggle; }
+
 protected:
 	/**
 	* Called when the character dies. Base implementation plays any dying animations 
@@ -204,6 +229,9 @@ protected:
 	UPROPERTY(ReplicatedUsing = OnRep_IsDying)
 	uint32 bIsDying : 1;
 
+	// Owning client's reload toggle. On the server, the last toggle received from the client.
+	uint32 bReloadInputToggle : 1;
+
 	UPROPERTY(BlueprintReadOnly, Transient, ReplicatedUsing = OnReceiveHit)
 	FReceiveHitInfo ReceiveHitInfo;
 
@@ -220,9 +248,6 @@ protected:
 	FName RadialDamageImpactBone;
 
 private:
-	UFUNCTION(Server, Reliable, WithValidation)
-	void ServerEquipWeapon(const EWeaponSlot WeaponSlot);
-
 	/**
 	* Server only.
 	* Kills the character. Sets the character up to be killed and removes replication.
@@ -238,6 +263,9 @@ private:
 
 	void UpdateViewTarget(const float DeltaSeconds);
 
+	/** Server only. Records the current hitbox into HitboxHistory. */
+	void RecordHitbox();
+
 	UFUNCTION()
 	void OnRep_IsDying();
 
@@ -255,12 +283,19 @@ private:
 	*/
 	void CreateDefaultLoadout();
 
+	/**
+	* Clients only.
+	* Starts streaming in the cosmetic assets of every weapon in the loadout, so they
+	* are loaded before each weapon is first equipped.
+	*/
+	void PreloadLoadoutAssets();
+
 private:
-	/** First person camera */
+	/** First person camera. Null on dedicated servers. */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
 	class UCameraComponent* FirstPersonCamera;
 
-	/** First person mesh */
+	/** First person mesh. Null on dedicated servers, and unregistered until the character is first person. */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Mesh, meta = (AllowPrivateAccess = "true"))
 	class USkeletalMeshComponent* FirstPersonMesh;
 
@@ -277,6 +312,9 @@ private:
 
 	uint8 JumpCounter = 0;
 
+	// Hitbox recorded each server tick to validate client hits
+	FBSHitboxHistory HitboxHistory;
+
 public:
 	/** Returns FirstPersonCamera subobject **/
 	FORCEINLINE class UCameraComponent* GetFirstPersonCamera() const { return FirstPersonCamera; }
@@ -17,4 +17,63 @@ public:
 	UBSCharacterMovementComponent(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
 
 	virtual float GetMaxSpeed() const override;
+
+	/** Owning client only. Gets the timestamp of the move currently being recorded. */
+	float GetClientMoveTimeStamp() const;
+
+	/** Server only. Gets the timestamp of the last move received from the owning client. */
+	float GetServerMoveTimeStamp() const;
+
+	/** UCharacterMovementComponent Interface Begin */
+	virtual class FNetworkPredictionData_Client* GetPredictionData_Client() const override;
+protected:
+	virtual void UpdateFromCompressedFlags(uint8 Flags) override;
+	/** UCharacterMovementComponent Interface End */
+};
+
+//-----------------------------------------------------------------
+// Saved move that also records the weapon input of the owning
+// client. Weapon input travels in the move's compressed flags, so
+// it reaches the server in order with movement and needs no
+// reliable RPCs of its own.
+//-----------------------------------------------------------------
+class FSavedMove_BSCharacter : public FSavedMove_Character
+{
+public:
+	typedef FSavedMove_Character Super;
+
+	enum CompressedFlags
+	{
+		// The equipped weapon is firing
+		FLAG_TriggerHeld	= FLAG_Custom_0,
+
+		// Flipped every time the equipped weapon starts reloading
+		FLAG_Reload			= FLAG_Custom_1,
+
+		// The secondary weapon slot is active
+		FLAG_SecondarySlot	= FLAG_Custom_2,
+	};
+
+	/** FSavedMove_Character Interface Begin */
+	virtual void Clear() override;
+	virtual uint8 GetCompressedFlags() const override;
+	virtual bool CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const override;
+	virtual void SetMoveFor(ACharacter* Character, float InDeltaTime, FVector const& NewAccel, class FNetworkPredictionData_Client_Character& ClientData) override;
+	/** FSavedMove_Character Interface End */
+
+	uint32 bTriggerHeld : 1;
+
+	uint32 bReloadToggle : 1;
+
+	uint32 bSecondarySlot : 1;
+};
+
+class FNetworkPredictionData_Client_BSCharacter : public FNetworkPredictionData_Client_Character
+{
+public:
+	typedef FNetworkPredictionData_Client_Character Super;
+
+	FNetworkPredictionData_Client_BSCharacter(const UCharacterMovementComponent& ClientMovement);
+
+	virtual FSavedMovePtr AllocateNewMove() override;
 };
@@ -0,0 +1,146 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+class ABSCharacter;
+
+//-----------------------------------------------------------------
+// Snapshot of a character's hitbox at a point in server time.
+// The hitbox is the character's upright collision capsule, which
+// bounds every bone a weapon trace can hit.
+//-----------------------------------------------------------------
+struct FBSHitboxFrame
+{
+	/** Server world time the frame was recorded */
+	float Time = 0.f;
+
+	/** World center of the hitbox capsule */
+	FVector Center = FVector::ZeroVector;
+
+	/** Half height of the capsule, including the hemisphere caps */
+	float HalfHeight = 0.f;
+
+	/** Radius of the capsule */
+	float Radius = 0.f;
+};
+
+/**
+ * Fixed size ring buffer of hitbox frames recorded for a single character.
+ * Used by the server to rewind a character to the time a client fired a shot.
+ * Recording and sampling never allocate.
+ */
+class FBSHitboxHistory
+{
+public:
+	/** Number of frames kept. Covers ~1 second of history at a 60hz server tick. */
+	static const int32 MAX_FRAMES = 64;
+
+	/**
+	* Records a new hitbox frame, overwriting the oldest frame when full.
+	* Frames must be recorded in increasing time order.
+	*/
+	void Record(const float Time, const FVector& Center, const float HalfHeight, const float Radius);
+
+	/**
+	* Gets the hitbox at a specified time, interpolated between the two recorded frames
+	* surrounding it. Times outside of the recorded history are clamped to the oldest or
+	* newest frame.
+	*
+	* @param Time		The server time to sample.
+	* @param OutFrame	The sampled hitbox frame.
+	* @returns True if any frames have been recorded.
+	*/
+	bool GetFrameAtTime(const float Time, FBSHitboxFrame& OutFrame) const;
+
+	/** Clears all recorded frames */
+	void Reset();
+
+	bool IsEmpty() const { return Count == 0; }
+
+private:
+	/** Gets a recorded frame, where 0 is the oldest frame */
+	const FBSHitboxFrame& GetFrame(const int32 Index) const;
+
+private:
+	FBSHitboxFrame Frames[MAX_FRAMES];
+
+	/** Index the next frame will be written to */
+	int32 Head = 0;
+
+	/** Number of valid frames */
+	int32 Count = 0;
+};
+
+/**
+ * Server side helpers used to validate and resolve weapon traces against rewound
+ * character hitboxes. Characters are rewound analytically using their FBSHitboxHistory,
+ * so the physics scene is never moved.
+ */
+struct FBSLagCompensation
+{
+	/** A character hit found by a rewound trace */
+	struct FRewoundHit
+	{
+		ABSCharacter* Character = nullptr;
+
+		/** Point on the trace closest to the rewound hitbox */
+		FVector Location = FVector::ZeroVector;
+
+		/** Distance from the trace start to Location */
+		float Distance = 0.f;
+	};
+
+	/**
+	* Estimates the server time a controller was viewing the world at when it
+	* fired a shot that the server is processing now.
+	*
+	* @param Shooter			The controller that fired the shot.
+	* @param World				The world the shot was fired in.
+	* @param TimeBeforeLatest	How long before the shooter's latest received shot this shot was fired.
+	*/
+	static float GetRewindTime(const AController* Shooter, const UWorld* World, const float TimeBeforeLatest = 0.f);
+
+	/**
+	* Traces a segment against a single character's hitbox rewound to a specified time.
+	*
+	* @param Character		The character to rewind.
+	* @param Start			Start of the trace.
+	* @param End			End of the trace.
+	* @param RewindTime		The server time to rewind the character to.
+	* @param OutLocation	Point on the trace closest to the rewound hitbox.
+	* @returns True if the trace hits the rewound hitbox.
+	*/
+	static bool RewindTraceCharacter(const ABSCharacter& Character, const FVector& Start, const FVector& End, const float RewindTime, FVector& OutLocation);
+
+	/**
+	* Traces a segment against the hitboxes of all living characters rewound to a specified
+	* time. Hits are sorted by distance from Start.
+	*
+	* @param World			The world to trace in.
+	* @param Start			Start of the trace.
+	* @param End			End of the trace.
+	* @param RewindTime		The server time to rewind characters to.
+	* @param IgnoreActor	Character to ignore, usually the shooter.
+	* @param OutHits		Output of the characters hit.
+	*/
+	static void RewindTraceMulti(UWorld* World, const FVector& Start, const FVector& End, const float RewindTime, const AActor* IgnoreActor, TArray<FRewoundHit>& OutHits);
+
+	/**
+	* Checks if static world geometry blocks a segment. Only static geometry is tested
+	* since it is the only geometry that is not affected by rewinding.
+	*/
+	static bool IsOccluded(UWorld* World, const FVector& Start, const FVector& End, const AActor* IgnoreActor);
+
+	/**
+	* Checks the start of a shot reported by a client against the shooter's eyes, rewound to
+	* the time the shot was fired. The start must be close to the eyes with no static geometry
+	* in between, since shots are traced and occlusion tested from it.
+	*
+	* @param World			The world the shot was fired in.
+	* @param Shooter		The character that fired the shot.
+	* @param Start			Start of the shot reported by the client.
+	* @param ShotTime		The server time the shot was fired at.
+	* @returns True if the shot may be traced from Start.
+	*/
+	static bool IsShotStartValid(UWorld* World, const ABSCharacter& Shooter, const FVector& Start, const float ShotTime);
+};
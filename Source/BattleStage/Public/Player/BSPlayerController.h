@@ -6,6 +6,144 @@
 #include "BSPlayerController.generated.h"
 
 class ABSCharacter;
+class ABSWeapon;
+
+// Max shot results sent in a single damage feedback message
+static const int32 MAX_FEEDBACK_SHOT_RESULTS = 64;
+
+//-----------------------------------------------------------------
+// Damage dealt and received by a player during a single server
+// frame. Sent to the player's client in one unreliable RPC
+// instead of an RPC per damage event.
+//-----------------------------------------------------------------
+USTRUCT()
+struct FDamageFeedback
+{
+	GENERATED_USTRUCT_BODY()
+
+	// Number of hits dealt by the player's weapons
+	UPROPERTY()
+	uint8 HitsDealt = 0;
+
+	// Number of hits the player's character received
+	UPROPERTY()
+	uint8 HitsReceived = 0;
+
+	// Total damage dealt, rounded
+	UPROPERTY()
+	uint16 DamageDealt = 0;
+
+	// Total damage received, rounded
+	UPROPERTY()
+	uint16 DamageReceived = 0;
+
+	// World location of the source of the strongest hit received
+	UPROPERTY()
+	FVector_NetQuantize StrongestSourceLocation = FVector::ZeroVector;
+
+	// Damage of the strongest hit received. Not replicated.
+	float StrongestSourceDamage = 0.f;
+
+	// Weapon that fired the shots in ConfirmedShots and RejectedShots
+	UPROPERTY()
+	ABSWeapon* ShotWeapon = nullptr;
+
+	// Shot indices of character hits the server has validated
+	UPROPERTY()
+	TArray<uint16> ConfirmedShots;
+
+	// Shot indices of character hits the server has rejected
+	UPROPERTY()
+	TArray<uint16> RejectedShots;
+
+	bool HasFeedback() const { return HitsDealt > 0 || HitsReceived > 0 || HasShotResults(); }
+
+	bool HasShotResults() const { return ConfirmedShots.Num() > 0 || RejectedShots.Num() > 0; }
+
+	/** Adds a hit dealt by the player. */
+	void AddHitDealt(const float Damage)
+	{
+		HitsDealt = FMath::Min<int32>(HitsDealt + 1, MAX_uint8);
+		DamageDealt = FMath::Min<int32>(DamageDealt + FMath::RoundToInt(FMath::Max(Damage, 0.f)), MAX_uint16);
+	}
+
+	/** Adds a hit received by the player, keeping the source of the strongest hit. */
+	void AddHitReceived(const float Damage, const FVector& SourceLocation)
+	{
+		if (HitsReceived == 0 || Damage > StrongestSourceDamage)
+		{
+			StrongestSourceDamage = Damage;
+			StrongestSourceLocation = SourceLocation;
+		}
+
+		HitsReceived = FMath::Min<int32>(HitsReceived + 1, MAX_uint8);
+		DamageReceived = FMath::Min<int32>(DamageReceived + FMath::RoundToInt(FMath::Max(Damage, 0.f)), MAX_uint16);
+	}
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+	{
+		bOutSuccess = true;
+
+		uint8 bHasDealt = HitsDealt > 0;
+		uint8 bHasReceived = HitsReceived > 0;
+		uint8 bHasShotResults = HasShotResults();
+		Ar.SerializeBits(&bHasDealt, 1);
+		Ar.SerializeBits(&bHasReceived, 1);
+		Ar.SerializeBits(&bHasShotResults, 1);
+
+		if (bHasDealt) // Only send the half of the feedback that has hits
+		{
+			uint32 PackedHits = HitsDealt;
+			Ar.SerializeIntPacked(PackedHits);
+			HitsDealt = static_cast<uint8>(PackedHits);
+
+			uint32 PackedDamage = DamageDealt;
+			Ar.SerializeIntPacked(PackedDamage);
+			DamageDealt = static_cast<uint16>(PackedDamage);
+		}
+
+		if (bHasReceived)
+		{
+			uint32 PackedHits = HitsReceived;
+			Ar.SerializeIntPacked(PackedHits);
+			HitsReceived = static_cast<uint8>(PackedHits);
+
+			uint32 PackedDamage = DamageReceived;
+			Ar.SerializeIntPacked(PackedDamage);
+			DamageReceived = static_cast<uint16>(PackedDamage);
+
+			bool bOutSuccessLocal = true;
+			StrongestSourceLocation.NetSerialize(Ar, Map, bOutSuccessLocal);
+			bOutSuccess &= bOutSuccessLocal;
+		}
+
+		if (bHasShotResults)
+		{
+			bOutSuccess &= SerializeShotResults(Ar, Map);
+		}
+
+		return true;
+	}
+
+	/**
+	* Serializes a list of shot indices, up to MAX_FEEDBACK_SHOT_RESULTS.
+	* @returns False if the list is too long.
+	*/
+	static bool SerializeShotIndices(FArchive& Ar, TArray<uint16>& ShotIndices);
+
+private:
+	/** Serializes ShotWeapon, ConfirmedShots and RejectedShots. */
+	bool SerializeShotResults(FArchive& Ar, class UPackageMap* Map);
+};
+
+template<>
+struct TStructOpsTypeTraits< FDamageFeedback > : public TStructOpsTypeTraitsBase
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
 
 /**
  * 
@@ -31,18 +169,45 @@ public:
 	void ClientSetSpectatorCamera(const FVector CameraLocation, const FRotator CameraRotation);
 
 	/**
+	* Server only.
 	* Notifies the controller it has hit a character with a weapon under the control of the it's pawn.
-	* Results in a RPC on the client that notifies a weapon hit.
+	* Hits are accumulated and sent to the client with the rest of the frame's damage feedback.
+	*
+	* @param Damage	The damage dealt by the hit.
 	*/
-	virtual void NotifyWeaponHit();
+	virtual void NotifyWeaponHit(const float Damage);
 
 	/**
+	* Server only.
 	* Notifies the controller that the controlled character has received damage in game.
-	* Results in a RPC on the client that notifies damage receieved.
+	* Hits are accumulated and sent to the client with the rest of the frame's damage feedback.
 	*
 	* @param SourcePosition	The world position of the source of the damage.
+	* @param Damage			The damage received.
 	*/
-	virtual void NotifyReceivedDamage(const FVector& SourcePosition);
+	virtual void NotifyReceivedDamage(const FVector& SourcePosition, const float Damage);
+
+	/**
+	* Server only.
+	* Notifies the controller of the server's verdict on a character hit claimed by its client.
+	* Sent to the client with the rest of the frame's damage feedback to confirm or cancel
+	* the client's predicted hit marker.
+	*
+	* @param Weapon			The weapon that fired the shot.
+	* @param ShotIndex		Index of the shot fired by the weapon.
+	* @param bConfirmed		If the server validated the hit.
+	*/
+	void NotifyShotResult(ABSWeapon* Weapon, const uint16 ShotIndex, const bool bConfirmed);
+
+	/**
+	* Owning client only.
+	* Notifies the controller that a locally fired shot hit a character, before the server
+	* has validated it. Shows a provisional hit marker on the HUD.
+	*
+	* @param Weapon			The weapon that fired the shot.
+	* @param ShotIndex		Index of the shot fired by the weapon.
+	*/
+	void NotifyPredictedHit(ABSWeapon* Weapon, const uint16 ShotIndex);
 
 	/**
 	* Toggles the in-game menu.
@@ -80,11 +245,14 @@ public:
 	virtual void ClientReturnToMainMenu_Implementation(const FString& ReturnReason) override;
 
 protected:
-	UFUNCTION(Client, Unreliable)
-	void ClientNotifyWeaponHit();
+	/** Sends the damage feedback accumulated this frame to the client. */
+	void FlushDamageFeedback();
+
+	/** Makes sure the damage feedback is flushed next tick. Call before adding to PendingDamageFeedback. */
+	void ScheduleDamageFeedbackFlush();
 
 	UFUNCTION(Client, Unreliable)
-	void ClientNotifyReceivedDamage(const FVector& SourcePosition);
+	void ClientReceiveDamageFeedback(const FDamageFeedback& Feedback);
 
 	void TurnOffAllPawns();
 
@@ -148,6 +316,9 @@ protected:
 
 private:
 	ABSCharacter* BSCharacter = nullptr; //< If valid, the owning BSCharacter
+
+	/** Damage feedback accumulated this frame, waiting to be flushed. Server only. */
+	FDamageFeedback PendingDamageFeedback;
 	
 	UBSUserWidget* InGameMenuWidget = nullptr;
 	
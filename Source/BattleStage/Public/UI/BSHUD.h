@@ -7,6 +7,7 @@
 
 class UUserWidget;
 class ABSCharacter;
+class ABSWeapon;
 
 struct FScoreEvent;
 enum class EScoreType : uint8;
@@ -47,16 +48,41 @@ public:
 	FOnNotifyReceivedDamageEvent OnNotifyReceivedDamage;
 
 public:
-	/** Notifies the HUD when a controlled weapon has hit a character. */
-	void NotifyWeaponHit();
+	/** 
+	 * Notifies the HUD when a controlled weapon has hit a character. 
+	 * 
+	 * @param Damage	Total damage dealt by the hits since the last notification.
+	 */
+	void NotifyWeaponHit(const int32 Damage);
+
+	/**
+	* Notifies the HUD that a shot fired by a controlled weapon hit a character on this client,
+	* before the server has validated the hit. A provisional hit marker is displayed until the
+	* server's result for the shot is received.
+	*
+	* @param Weapon		The weapon that fired the shot.
+	* @param ShotIndex	Index of the shot fired by the weapon.
+	*/
+	void NotifyPredictedHit(ABSWeapon* Weapon, const uint16 ShotIndex);
+
+	/**
+	* Notifies the HUD of the server's results for predicted hits. Resolved hits stop displaying
+	* their provisional hit marker. Confirmed hits are also reported through NotifyWeaponHit.
+	*
+	* @param Weapon				The weapon that fired the shots.
+	* @param ConfirmedShots		Shot indices of hits the server validated.
+	* @param RejectedShots		Shot indices of hits the server rejected.
+	*/
+	void NotifyShotResults(ABSWeapon* Weapon, const TArray<uint16>& ConfirmedShots, const TArray<uint16>& RejectedShots);
 
 	/** 
 	 * Notifies the HUD that the controlled character has received damage in game. 
 	 * Will activate HUD based effects that respond to damage events.
 	 * 
 	 * @param SourcePosition	The world position of the source of the damage.
+	 * @param Damage			Total damage received since the last notification.
 	 */
-	void NotifyReceivedDamage(const FVector& SourcePosition);
+	void NotifyReceivedDamage(const FVector& SourcePosition, const int32 Damage);
 
 	/** Check if the game scoreboard is up */
 	bool IsGameScoreboardUp() const;
@@ -137,6 +163,18 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = HitIndication)
 	USoundBase* HitIndicatorSound = nullptr;
 
+	/** Color of the hit indicator while a predicted hit waits for the server */
+	UPROPERTY(EditDefaultsOnly, Category = HitIndication)
+	FColor PredictedHitColor = FColor(255, 255, 255, 160);
+
+	/** Seconds a predicted hit is displayed without a result from the server */
+	UPROPERTY(EditDefaultsOnly, Category = HitIndication)
+	float PredictedHitTimeout = 0.5f;
+
+	/** Damage dealt at which the hit indicator is displayed at full opacity */
+	UPROPERTY(EditDefaultsOnly, Category = HitIndication)
+	float HitIndicatorFullDamage = 50.f;
+
 	/** Indicator used when damaged to indicate direction of incoming damage */
 	UPROPERTY(EditAnywhere, Category = DamageIndication)
 	UTexture2D* DamageIndicator = nullptr;
@@ -145,6 +183,10 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = DamageIndication)
 	float DamageIndicatorDuration = 1.f;
 
+	/** Damage received at which the damage indicator is displayed at full opacity */
+	UPROPERTY(EditDefaultsOnly, Category = DamageIndication)
+	float DamageIndicatorFullDamage = 50.f;
+
 	/** Full screen texture applied with modulated alpha relative to current health */
 	UPROPERTY(EditAnywhere, Category = DamageIndication)
 	UTexture2D* LowHealthOverlay = nullptr;
@@ -175,6 +217,14 @@ private:
 		float ExpireTime = 0;
 	};
 
+	/** A character hit predicted by this client, waiting for the server's result */
+	struct FPredictedHit
+	{
+		TWeakObjectPtr<ABSWeapon> Weapon;
+		uint16 ShotIndex = 0;
+		float Time = 0; // Game time of the hit
+	};
+
 private:
 	UPROPERTY()
 	UBSHUDLayout* HUDLayout = nullptr;
@@ -184,6 +234,12 @@ private:
 
 	/** Game time of last weapon hit */
 	float LastWeaponHitTime = 0.f;
+
+	/** Total damage dealt by the last weapon hit notification */
+	int32 LastWeaponHitDamage = 0;
+
+	/** Predicted hits that haven't been resolved by the server, oldest first */
+	TArray<FPredictedHit> PredictedHits;
 	
 	/** Game time of last time damage was received */
 	float LastDamagedTime = 0.f;
@@ -191,6 +247,9 @@ private:
 	/** Origin position of last damage event */
 	FVector DamageOrigin = FVector::ZeroVector;
 
+	/** Total damage received in the last damage event */
+	int32 LastDamageReceived = 0;
+
 	/** 
 	 * Text representation of events in the event feed and the number
 	 * of seconds each event has been in the feed. 
@@ -6,30 +6,76 @@
 #include "BSInstantShot.generated.h"
 
 
+// Number of recent shots kept in FInstantShotRepBuffer
+static const int32 MAX_REPLICATED_SHOTS = 8;
+
 //-----------------------------------------------------------------
-// Shot data used to replicate effects to remotes for 
-// UBSInstantShot
+// A single shot replicated to remotes for UBSInstantShot
 //-----------------------------------------------------------------
 USTRUCT()
-struct FInstantShotRep
+struct FInstantShotRep : public FFastArraySerializerItem
 {
 	GENERATED_BODY()
 
 	UPROPERTY()
 	FVector_NetQuantize10 Target = FVector::ZeroVector;
 
+	// Sequence number of the shot. Used by remotes to replay shots in order.
+	UPROPERTY()
+	uint16 Sequence = 0;
+
+	// Seed of shot types that trace more than once per shot, such as pellet shots
+	UPROPERTY()
+	uint16 Seed = 0;
+};
+
+//-----------------------------------------------------------------
+// Ring buffer of the most recent shots fired by a UBSInstantShot.
+// Replicated as a fast array, so only shots added since the last
+// update are sent. Remotes replay every shot they have not seen
+// yet in sequence order.
+//-----------------------------------------------------------------
+USTRUCT()
+struct FInstantShotRepBuffer : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
 	UPROPERTY()
-	uint32 FireToggle : 1;
+	TArray<FInstantShotRep> Shots;
 
-	bool operator==(const FInstantShotRep& Other)
+	/** Adds a shot, overwriting the oldest shot when full. */
+	void AddShot(const FVector& Target, const uint16 Seed = 0)
 	{
-		return Target == Target && FireToggle == FireToggle;
+		if (Shots.Num() < MAX_REPLICATED_SHOTS)
+		{
+			Shots.AddDefaulted();
+		}
+
+		FInstantShotRep& Shot = Shots[NextSequence % MAX_REPLICATED_SHOTS];
+		Shot.Target = Target;
+		Shot.Seed = Seed;
+		Shot.Sequence = NextSequence++;
+
+		MarkItemDirty(Shot);
 	}
 
-	bool operator!=(const FInstantShotRep& Other)
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
 	{
-		return Target != Target || FireToggle != FireToggle;
+		return FastArrayDeltaSerialize<FInstantShotRep>(Shots, DeltaParms, *this);
 	}
+
+private:
+	// Sequence number of the next shot. Server only.
+	uint16 NextSequence = 0;
+};
+
+template<>
+struct TStructOpsTypeTraits< FInstantShotRepBuffer > : public TStructOpsTypeTraitsBase
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
 };
 
 /**
@@ -60,6 +106,15 @@ protected:
 
 	void PlayImpactEffects(const FHitResult& Hit) const;
 
+	/**
+	* Plays impact effects for a hit on a specific surface type. Used when the hit was rebuilt 
+	* from a FShotHitRecord and doesn't have a physical material.
+	*/
+	void PlayImpactEffects(const FHitResult& Hit, const EPhysicalSurface SurfaceType) const;
+
+	/** Plays impact effects for multiple hits in a single call to the impact effect. */
+	void PlayImpactEffects(const TArray<FHitResult>& Hits) const;
+
 	/**
 	* Processes a shot hit event from clients. Intended to only be called by the server to respond
 	* to a possible hit by a client shot trace. The hit will be validated and processed on the server.
@@ -68,6 +123,25 @@ protected:
 	*/
 	void ProcessHit(const FShotData& ShotData);
 
+	/**
+	* Server only. Validates a hit reported by a client. Character hits are re-traced against the
+	* character's hitbox rewound to the time the shooter fired, and rejected if the shot misses the
+	* rewound hitbox or is blocked by static world geometry.
+	* 
+	* @param ShotData	The shot data from the hit.
+	* @returns True if the hit is valid.
+	*/
+	bool ValidateHit(const FShotData& ShotData) const;
+
+	/**
+	* Server only. Sends the result of validating a character hit to the shooter's client, which
+	* confirms or cancels the hit marker it predicted for the shot.
+	* 
+	* @param ShotData	The shot data from the hit.
+	* @param bConfirmed	If the hit was validated.
+	*/
+	void NotifyHitResult(const FShotData& ShotData, const bool bConfirmed) const;
+
 	/**
 	* Processes a shot miss event from clients. Intended to only be called by the server to respond
 	* to shot misses.
@@ -84,10 +158,42 @@ protected:
 	*/
 	void RespondValidatedShot(const FShotData& ShotData);
 	
+	/**
+	* Server only. Replicates a shot to remotes, which will simulate it with SimulateShotRep.
+	* 
+	* @param Target	The end location of the shot.
+	* @param Seed	Seed of shot types that trace more than once per shot.
+	*/
+	void SimulateOnRemotes(const FVector& Target, const uint16 Seed = 0);
+
+	/** Remotes only. Simulates a replicated shot. Simulates a single trace to its target by default. */
+	virtual void SimulateShotRep(const FInstantShotRep& Shot);
+
 	/**
 	* Simulates shot effects to a target location. Only plays visual and audible effects.
+	* The impact is found with an async trace, limited by a per frame budget. Shots over
+	* budget or far from the local view end at Target without an impact effect.
+	*/
+	virtual void SimulateFire(const FVector& Target) const;
+
+	/**
+	* Simulates the effects of a single trace with an async trace, limited by the per frame
+	* cosmetic trace budget shared by all instant shots. 
+	* 
+	* @param Start		The start of the trace.
+	* @param End		The end of the trace.
+	* @param Fallback	Where the trail ends if the trace is over budget or far from the local view.
 	*/
-	void SimulateFire(const FVector& Target) const;
+	void SimulateTrace(const FVector& Start, const FVector& End, const FVector& Fallback) const;
+
+	/** Checks if a simulated shot passes close enough to the local view to be worth tracing. */
+	bool IsCosmeticTraceRelevant(const FVector& Start, const FVector& End) const;
+
+	/** Called when an async trace started by SimulateTrace completes. */
+	void OnCosmeticTraceDone(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum) const;
+
+	/** Plays trail and impact effects for a traced shot. */
+	void PlayShotEffects(const FHitResult& Impact) const;
 
 	/**
 	* Performs a weapon trace from a start location to a end location.
@@ -108,9 +214,16 @@ protected:
 	TSubclassOf<class UDamageType> DamageType = UDamageType::StaticClass();
 
 private:
-	// Shot data used to replicate shot effects on remotes
+	// Recent shots used to replicate shot effects on remotes
 	UPROPERTY(Transient, ReplicatedUsing = OnRep_ShotRep)
-	FInstantShotRep ShotRep;
+	FInstantShotRepBuffer ShotRep;
+
+	// Sequence of the last shot simulated from ShotRep. Remotes only.
+	uint16 LastSimulatedSequence = 0;
+
+	// If ShotRep has been received before. Shots in the first update were
+	// fired before this remote could see them and are not simulated.
+	bool bReceivedShotRep = false;
 
 private:
 	UFUNCTION()
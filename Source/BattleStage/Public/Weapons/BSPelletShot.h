@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Weapons/BSInstantShot.h"
+#include "BSPelletShot.generated.h"
+
+//-----------------------------------------------------------------
+// A pellet shot waiting on its async pellet traces on the server
+//-----------------------------------------------------------------
+struct FPendingPelletShot
+{
+	FShotData ShotData;
+
+	/** Server time characters are rewound to */
+	float RewindTime = 0.f;
+
+	TArray<FVector> Directions;
+
+	/** Distance each pellet travels before being blocked by static geometry */
+	TArray<float> BlockDistances;
+
+	int32 RemainingTraces = 0;
+};
+
+/**
+ * Instant hit shot type that fires multiple pellets per shot.
+ *
+ * Only the regular shot data is sent to the server. Pellet directions are generated from
+ * the shot's random stream, so the server rebuilds every pellet itself. The server runs all
+ * pellet traces against static world geometry asynchronously, resolves character hits against
+ * rewound hitboxes, and applies damage once per hit character.
+ *
+ * Shots are replicated to remotes through the instant shot ring buffer, with the pellet seed
+ * alongside the end of the cone's center line.
+ */
+UCLASS(Abstract)
+class BATTLESTAGE_API UBSPelletShot : public UBSInstantShot
+{
+	GENERATED_BODY()
+
+public:
+	UBSPelletShot(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+	/** UBSShotType interface */
+	virtual bool GetShotData(FShotData& OutShotData) const override;
+	virtual void PreInvokeShot(const FShotData& ShotData) override;
+	virtual void InvokeShot(const FShotData& ShotData) override;
+	/** UBSShotType interface end */
+
+protected:
+	/** Gets the seed used to generate the pellet directions of a shot. */
+	uint16 GetPelletSeed(const FShotData& ShotData) const;
+
+	/**
+	* Generates the direction of every pellet in a shot.
+	*
+	* @param Direction		Center direction of the pellet cone.
+	* @param PelletSeed		Seed of the stream used to generate pellet directions.
+	* @param OutDirections	Output of the pellet directions.
+	*/
+	void GetPelletDirections(const FVector& Direction, const uint16 PelletSeed, TArray<FVector>& OutDirections) const;
+
+	/**
+	* Traces every pellet of a shot and plays visual and audible effects. Used by the shooter
+	* and remotes only, never affects gameplay.
+	*
+	* @param bAsync		If pellets are traced through the budgeted async cosmetic traces. The
+	*					shooter traces immediately so its own shots have no delay.
+	*/
+	void SimulatePellets(const FVector& Start, const FVector& Direction, const uint16 PelletSeed, const bool bAsync) const;
+
+	/** UBSInstantShot interface */
+	virtual void SimulateShotRep(const FInstantShotRep& Shot) override;
+	/** UBSInstantShot interface end */
+
+	/** Called when an async pellet trace started by InvokeShot completes. */
+	void OnPelletTraceDone(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum);
+
+	/** Server only. Resolves pellet hits and applies damage once all pellet traces of a shot are done. */
+	void ResolvePellets(const uint16 ShotIndex);
+
+protected:
+	// Number of pellets fired per shot
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, meta = (ClampMin = "1", ClampMax = "64", UIMin = "1", UIMax = "64"), Category = PelletShot)
+	int32 PelletCount = 8;
+
+	// Angle, in degrees, of the half cone pellets are spread in around the shot direction
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, meta = (ClampMin = "0.0", ClampMax = "45.0", UIMin = "0.0", UIMax = "45.0"), Category = PelletShot)
+	float PelletSpread = 5.f;
+
+	// Max distance of a pellet
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = PelletShot)
+	float PelletRange = 3000.f;
+
+private:
+	// Shots waiting on async traces, keyed by shot index
+	TMap<uint16, FPendingPelletShot> PendingShots;
+
+	FTraceDelegate PelletTraceDelegate;
+};
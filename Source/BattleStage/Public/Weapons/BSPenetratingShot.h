@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Weapons/BSInstantShot.h"
+#include "BSPenetratingShot.generated.h"
+
+/**
+ * Instant hit shot type that passes through surfaces.
+ *
+ * Every surface along the shot is found with a single multi hit trace, never by tracing
+ * again from each exit point. Damage is reduced by a factor for each surface the shot passes
+ * through, based on the surface type. The server resolves the shot itself, testing characters
+ * against their rewound hitboxes, and applies damage once per victim.
+ */
+UCLASS(Abstract)
+class BATTLESTAGE_API UBSPenetratingShot : public UBSInstantShot
+{
+	GENERATED_BODY()
+
+public:
+	UBSPenetratingShot(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+	/** UBSShotType interface */
+	virtual bool GetShotData(FShotData& OutShotData) const override;
+	virtual void PreInvokeShot(const FShotData& ShotData) override;
+	virtual void InvokeShot(const FShotData& ShotData) override;
+	/** UBSShotType interface end */
+
+protected:
+	/** UBSInstantShot interface */
+	virtual void SimulateFire(const FVector& Target) const override;
+	/** UBSInstantShot interface end */
+
+	/**
+	* Traces every surface between two locations with a single multi hit trace. Hits are
+	* sorted by distance from Start.
+	*/
+	void PenetrationTrace(const FVector& Start, const FVector& End, TArray<FHitResult>& OutHits) const;
+
+	/**
+	* Simulates a shot passing through surfaces. Only plays visual and audible effects.
+	*
+	* @param Start	Start of the shot.
+	* @param End	Max end location of the shot.
+	*/
+	void SimulatePenetration(const FVector& Start, const FVector& End) const;
+
+	/** Gets the damage scale applied after passing through a surface */
+	float GetPenetrationScale(const FHitResult& Hit) const;
+
+protected:
+	// Max distance of the shot
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = PenetratingShot)
+	float ShotRange = 10000.f;
+
+	// Max number of surfaces the shot can pass through
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = PenetratingShot)
+	int32 MaxPenetrations = 3;
+
+	// The shot stops once its damage falls below this
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = PenetratingShot)
+	float MinDamage = 1.f;
+
+	// Damage scale applied after passing through a character
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, meta = (ClampMin = "0.0", ClampMax = "1.0", UIMin = "0.0", UIMax = "1.0"), Category = PenetratingShot)
+	float CharacterPenetrationScale = 0.5f;
+
+	// Damage scale applied after passing through specific surface types
+	UPROPERTY(EditDefaultsOnly, meta = (ClampMin = "0.0", ClampMax = "1.0", UIMin = "0.0", UIMax = "1.0"), Category = PenetratingShot)
+	float SurfacePenetrationScale[SurfaceType_Max];
+};
@@ -21,7 +21,8 @@ public:
 
 	/** AActor Interface Begin */
 	virtual void PostInitializeComponents() override;
-	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void Tick(float DeltaSeconds) override;
 	/** AActor Interface End */
 
 	/**
@@ -31,6 +32,65 @@ public:
 	UFUNCTION(BlueprintCallable, Category = Projectile)
 	void Detonate();
 
+	/** Index of the weapon shot that fired this projectile */
+	uint16 GetShotIndex() const { return ShotIndex; }
+
+	/**
+	* Marks this projectile as a prediction spawned by the owning client ahead of the server's
+	* projectile. Predicted projectiles never apply damage. Must be called before the projectile
+	* is armed.
+	*/
+	void SetPredicted();
+
+	bool IsPredicted() const { return bIsPredicted; }
+
+	/** If this is a client's copy of a server projectile, simulated from replicated launch data */
+	bool IsReplica() const { return bIsReplica; }
+
+	/** Id of the projectile in the projectile manager's replicated projectiles */
+	uint16 GetProjectileId() const { return ProjectileId; }
+
+	/** Marks this projectile as owned by an ABSProjectileManager pool. Must be called before spawning finishes. */
+	void SetPooled() { bIsPooled = true; }
+
+	/**
+	* Arms the projectile for a new shot. Called every time the projectile is taken from the
+	* pool, and once for projectiles that aren't pooled. Resets detonation, movement and collision.
+	* 
+	* @param SpawnTransform	The location and direction of the shot.
+	* @param NewOwner		The weapon that fired the shot.
+	* @param NewInstigator	The character that fired the shot.
+	* @param NewShotIndex	Index of the weapon shot.
+	*/
+	void Arm(const FTransform& SpawnTransform, AActor* NewOwner, APawn* NewInstigator, const uint16 NewShotIndex);
+
+	/** Hides the projectile and stops its movement and collision while it waits in the pool. */
+	void Disarm();
+
+	/** Returns the projectile to its pool, or destroys it if it isn't pooled. */
+	void Recycle();
+
+	/** If the projectile is in use for a shot, rather than waiting in the pool */
+	bool IsArmed() const { return bIsArmed; }
+
+	/**
+	* Clients only. Detonates a replica when the server's detonation event is received. Only
+	* plays effects, the replica stays hidden until the server removes the projectile.
+	*/
+	void DetonateReplica(const FVector& Location);
+
+	/** Owning client only. Hands off from the predicted projectile for the same shot, if there is one. */
+	void ReconcileWithPrediction();
+
+	/**
+	* Owning client only. Called on a predicted projectile when the server's projectile for
+	* the same shot has replicated. The replica of the server's projectile is hidden while this
+	* projectile blends into its position, then this projectile is recycled.
+	* 
+	* @param AuthoritativeProjectile	The replica of the server's projectile for the same shot.
+	*/
+	void BeginReconcile(ABSProjectile* AuthoritativeProjectile);
+
 protected:
 	/**
 	* Detonates the projectile at a specified position and applies radial damage.
@@ -49,9 +109,12 @@ protected:
 	UFUNCTION()
 	virtual void OnStop(const FHitResult& ImpactResult);
 
+	/** Called on the server and predicting client after the projectile has been armed for a new shot. */
+	virtual void OnArmed();
+
 	/** 
 	 * Called after the projectile has been detonated to allow the server to deactivate itself and allow
-	 * detonation to be replicated to clients before destruction. 
+	 * detonation to be replicated to clients before it is recycled. 
 	 */
 	virtual void Deactivate();
 
@@ -59,12 +122,21 @@ protected:
 	UFUNCTION(BlueprintImplementableEvent, Category = Projectile)
 	void OnDeactivate();
 
-private:
-	UFUNCTION(Server, Reliable, WithValidation)
-	void ServerDetonate(const FVector& Location, const FRotator& Rotation);
+	/** Starts moving the projectile, simulated by the projectile manager when there is one. */
+	void StartSimulation(const FVector& Velocity);
 
-	UFUNCTION()
-	void OnRep_IsDetonated();
+	/** Stops moving the projectile. */
+	void StopSimulation();
+
+	/**
+	* Called by the projectile manager when the projectile's movement sweep is blocked. Bounces
+	* the projectile if its movement component is set to, and notifies OnImpact and OnStop.
+	* 
+	* @param Hit			The blocking hit.
+	* @param InOutVelocity	Velocity before the hit, and the bounced velocity after.
+	* @return If the projectile should keep moving.
+	*/
+	virtual bool HandleSimulatedHit(const FHitResult& Hit, FVector& InOutVelocity);
 
 protected:
 	/** Effect generated when the projectile is detonated */
@@ -77,7 +149,21 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Damage)
 	TSubclassOf<class UDamageType> DamageTypeClass;
 
+	/** Seconds before the projectile is recycled if it hasn't detonated */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Projectile)
+	float LifeTime = 3.f;
+
+	/** Seconds a predicted projectile takes to blend into the server's projectile */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Prediction)
+	float ReconcileBlendTime = 0.15f;
+
+	/** Seconds a predicted projectile waits for the server's projectile before being removed */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Prediction)
+	float MaxPredictionTime = 1.f;
+
 private:
+	friend class ABSProjectileManager;
+
 	/** Sphere collision component */
 	UPROPERTY(VisibleDefaultsOnly, Category = Projectile)
 	class USphereComponent* CollisionComp;
@@ -86,9 +172,46 @@ private:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Movement, meta = (AllowPrivateAccess = "true"))
 	class UProjectileMovementComponent* ProjectileMovement;
 
-	UPROPERTY(ReplicatedUsing = OnRep_IsDetonated)
 	uint32 bIsDetonated : 1;
 
+	uint16 ShotIndex = 0;
+
+	/** Id of the projectile in the projectile manager's replicated projectiles */
+	uint16 ProjectileId = 0;
+
+	/** World time the projectile was last armed */
+	float ArmTime = 0.f;
+
+	/** Recycles the projectile at the end of its LifeTime, or after detonation */
+	FTimerHandle RecycleTimer;
+
+	/** If this is a client side prediction of the server's projectile */
+	uint32 bIsPredicted : 1;
+
+	/** If this projectile is owned by an ABSProjectileManager pool */
+	uint32 bIsPooled : 1;
+
+	/** If this is a client's copy of a server projectile */
+	uint32 bIsReplica : 1;
+
+	/** If this projectile is in use for a shot */
+	uint32 bIsArmed : 1;
+
+	/** If the detonation effects have already been played by a predicted projectile */
+	uint32 bDetonateEffectsPlayed : 1;
+
+	/** 
+	 * On a predicted projectile, the server's projectile it is blending into.
+	 * On the server's projectile, the predicted projectile blending into it.
+	 */
+	TWeakObjectPtr<ABSProjectile> ReconcileProjectile;
+
+	/** Progress of blending into the server's projectile */
+	float ReconcileAlpha = 0.f;
+
+	/** Index in the projectile manager's simulation buffers, or INDEX_NONE when not moving */
+	int32 SimIndex = INDEX_NONE;
+
 public:
 	/** Returns CollisionComp subobject **/
 	FORCEINLINE class USphereComponent* GetCollisionComp() const { return CollisionComp; }
@@ -109,16 +232,16 @@ class BATTLESTAGE_API ABSImpactGrenade : public ABSProjectile
 public:
 	ABSImpactGrenade(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
 
-	/** AActor Interface Begin */
-	virtual void BeginPlay() override;
-	/** AActor Interface End */
-
 protected:
 	/** ABSProjectile Interface Begin */
+	virtual void OnArmed() override;
 	virtual void OnImpact(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit) override;
 	/** ABSProjectile Interface End */
 
 protected:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = ImpactGrenade)
 	float FuzeTime;
+
+private:
+	FTimerHandle FuzeTimer;
 };
\ No newline at end of file
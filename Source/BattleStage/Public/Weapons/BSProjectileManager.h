@@ -0,0 +1,245 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "GameFramework/Info.h"
+#include "Weapons/BSRadialDamageResolver.h"
+#include "BSProjectileManager.generated.h"
+
+class ABSProjectile;
+class ABSProjectileManager;
+class ABSWeapon;
+
+//-----------------------------------------------------------------
+// Number of projectiles of a class to spawn into the pool when
+// the match starts
+//-----------------------------------------------------------------
+USTRUCT()
+struct FProjectilePoolPrewarm
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditDefaultsOnly, Category = ProjectilePool)
+	TSubclassOf<ABSProjectile> ProjectileClass;
+
+	UPROPERTY(EditDefaultsOnly, meta = (ClampMin = "0", UIMin = "0"), Category = ProjectilePool)
+	int32 Count = 0;
+};
+
+//-----------------------------------------------------------------
+// Launch data of a server projectile. Clients simulate their own
+// replica of the projectile from this data.
+//-----------------------------------------------------------------
+USTRUCT()
+struct FProjectileRep : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	uint16 ProjectileId = 0;
+
+	UPROPERTY()
+	TSubclassOf<ABSProjectile> ProjectileClass;
+
+	// The weapon that fired the projectile
+	UPROPERTY()
+	ABSWeapon* Weapon = nullptr;
+
+	UPROPERTY()
+	uint16 ShotIndex = 0;
+
+	// Server world time the projectile was launched
+	UPROPERTY()
+	float SpawnTime = 0.f;
+
+	UPROPERTY()
+	FVector_NetQuantize10 Origin = FVector::ZeroVector;
+
+	UPROPERTY()
+	FVector_NetQuantize10 Velocity = FVector::ZeroVector;
+
+	// Set once the server's projectile detonates
+	UPROPERTY()
+	FVector_NetQuantize10 DetonateLocation = FVector::ZeroVector;
+
+	UPROPERTY()
+	uint8 bDetonated : 1;
+
+	FProjectileRep()
+		: bDetonated(false)
+	{
+	}
+
+	void PostReplicatedAdd(const struct FProjectileRepArray& InArray);
+	void PostReplicatedChange(const struct FProjectileRepArray& InArray);
+	void PreReplicatedRemove(const struct FProjectileRepArray& InArray);
+};
+
+//-----------------------------------------------------------------
+// Every server projectile in flight. Replicated as a fast array,
+// so a projectile costs a single entry when launched and when
+// detonated instead of an actor channel streaming movement.
+//-----------------------------------------------------------------
+USTRUCT()
+struct FProjectileRepArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FProjectileRep> Projectiles;
+
+	// Manager that owns the array
+	ABSProjectileManager* Manager = nullptr;
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FastArrayDeltaSerialize<FProjectileRep>(Projectiles, DeltaParms, *this);
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits< FProjectileRepArray > : public TStructOpsTypeTraitsBase
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+/**
+ * Owns a pool of projectiles for each projectile class so shots reuse projectiles
+ * instead of spawning and destroying an actor per shot.
+ *
+ * Spawned by ABSGameState on the server. Projectiles are never replicated as actors. The
+ * server replicates each projectile's launch data and detonation as an entry in a fast array,
+ * and clients simulate their own replica of the projectile from it. Clients pool replicas and
+ * predicted projectiles the same way the server pools its projectiles.
+ *
+ * Projectile movement is simulated here rather than by each projectile's movement component.
+ * Every moving projectile is stored in flat arrays and advanced with a plain Euler step per
+ * tick, then each projectile sweeps its own movement with SweepSingleByChannel. This saves
+ * a component tick per projectile, it doesn't batch the sweeps. Hits are passed back to the
+ * projectile once every projectile has moved.
+ */
+UCLASS(NotPlaceable, Config = Game)
+class BATTLESTAGE_API ABSProjectileManager : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	ABSProjectileManager(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+	/** AActor Interface Begin */
+	virtual void BeginPlay() override;
+	virtual void Tick(float DeltaSeconds) override;
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	/** AActor Interface End */
+
+	/** Gets the projectile manager of a world, if one has replicated. */
+	static ABSProjectileManager* Get(const UWorld* World);
+
+	/**
+	* Takes a projectile from the pool, spawning one if the pool is empty, and arms it for a shot.
+	*
+	* @param ProjectileClass	Class of the projectile.
+	* @param SpawnTransform		The location and direction of the shot.
+	* @param NewOwner			The weapon that fired the shot.
+	* @param NewInstigator		The character that fired the shot.
+	* @param ShotIndex			Index of the weapon shot.
+	* @param bPredicted			If the projectile is a client side prediction of the server's projectile.
+	*/
+	ABSProjectile* AcquireProjectile(TSubclassOf<ABSProjectile> ProjectileClass, const FTransform& SpawnTransform, AActor* NewOwner, APawn* NewInstigator, const uint16 ShotIndex, const bool bPredicted);
+
+	/** Disarms a projectile and returns it to the pool. */
+	void ReleaseProjectile(ABSProjectile* Projectile);
+
+	/** Server only. Replicates the detonation of a projectile to clients. */
+	void NotifyDetonated(ABSProjectile* Projectile, const FVector& Location);
+
+	/**
+	* Server only. Queues radial damage from a detonation. Every detonation queued during a
+	* frame is resolved together at the end of the manager's next tick.
+	*/
+	void QueueRadialDamage(const FBSRadialDamageRequest& Request);
+
+	/** Starts simulating the movement of a projectile from its current location. */
+	void StartSimulating(ABSProjectile* Projectile, const FVector& Velocity);
+
+	/** Stops simulating the movement of a projectile. */
+	void StopSimulating(ABSProjectile* Projectile);
+
+protected:
+	/** Takes a disarmed projectile from the pool, spawning one if the pool is empty. */
+	ABSProjectile* TakeFromPool(TSubclassOf<ABSProjectile> ProjectileClass);
+
+	/** Spawns a disarmed projectile owned by the pool. */
+	ABSProjectile* SpawnPooledProjectile(TSubclassOf<ABSProjectile> ProjectileClass);
+
+	/** Gets the current server world time, as estimated on clients. */
+	float GetServerWorldTime() const;
+
+	/** Clients only. Launches a replica of a server projectile, caught up to the current server time. */
+	void OnProjectileAdded(const FProjectileRep& ProjectileRep);
+
+	/** Clients only. Detonates the replica of a server projectile. */
+	void OnProjectileChanged(const FProjectileRep& ProjectileRep);
+
+	/** Clients only. Recycles the replica of a server projectile. */
+	void OnProjectileRemoved(const FProjectileRep& ProjectileRep);
+
+	/** Advances every simulated projectile, sweeps their movement and notifies blocking hits. */
+	void SimulateProjectiles(const float DeltaSeconds);
+
+	/** Removes a projectile from the simulation buffers, filling its slot with the last projectile. */
+	void RemoveSimulated(const int32 Index);
+
+protected:
+	/** Projectiles spawned into the pool on the server when the match starts */
+	UPROPERTY(EditDefaultsOnly, Category = ProjectilePool)
+	TArray<FProjectilePoolPrewarm> Prewarm;
+
+private:
+	friend struct FProjectileRep;
+
+	/** Server projectiles in flight, replicated to every client */
+	UPROPERTY(Replicated)
+	FProjectileRepArray ReplicatedProjectiles;
+
+	/** Id of the next server projectile. Server only. */
+	uint16 NextProjectileId = 0;
+
+	/** Client replicas of server projectiles, keyed by projectile id. Clients only. */
+	TMap<uint16, TWeakObjectPtr<ABSProjectile>> Replicas;
+
+	/** Resolves radial damage from detonations. Server only. */
+	FBSRadialDamageResolver RadialDamageResolver;
+
+	/** Disarmed projectiles, by class */
+	TMap<UClass*, TArray<TWeakObjectPtr<ABSProjectile>>> FreeProjectiles;
+
+	//-----------------------------------------------------------------
+	// Simulation buffers. Every array is indexed by ABSProjectile::SimIndex.
+	//-----------------------------------------------------------------
+
+	UPROPERTY(Transient)
+	TArray<ABSProjectile*> SimProjectiles;
+
+	TArray<FVector> SimLocations;
+
+	TArray<FVector> SimVelocities;
+
+	/** Gravity applied to each projectile, already scaled by its gravity scale */
+	TArray<float> SimGravityZ;
+
+	/** Max speed of each projectile, or 0 for no limit */
+	TArray<float> SimMaxSpeeds;
+
+	/** Location of each projectile at the start of the current step */
+	TArray<FVector> StepStartLocations;
+
+	/** Blocking hits found by the current step */
+	TArray<FHitResult> StepHits;
+
+	/** Projectiles that were blocked by StepHits */
+	TArray<TWeakObjectPtr<ABSProjectile>> StepHitProjectiles;
+};
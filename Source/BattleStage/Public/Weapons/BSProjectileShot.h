@@ -19,16 +19,38 @@ public:
 	// UBSShotType Interface
 	//-----------------------------------------------------------------
 	virtual bool GetShotData(FShotData& OutShotData) const override;
+	virtual void PreInvokeShot(const FShotData& ShotData) override;
 	virtual void InvokeShot(const FShotData& ShotData) override;
 	//-----------------------------------------------------------------
 	// UBSShotType Interface End 
 	//-----------------------------------------------------------------	
 
+	/**
+	* Owning client only. Matches the replica of a server projectile with the predicted
+	* projectile spawned for the same shot, and begins blending the prediction out.
+	* 
+	* @param Projectile	The replica of the server's projectile.
+	*/
+	void ReconcileProjectile(class ABSProjectile* Projectile);
+
 protected:
-	/** Spawns a projectile of ProjectileType */
-	virtual void SpawnProjectile(FVector Location, FVector_NetQuantize Direction) const;
+	/** 
+	 * Spawns a projectile of ProjectileType for a shot.
+	 *
+	 * @param ShotData		The shot to spawn the projectile for.
+	 * @param bPredicted	If the projectile is a client side prediction of the server's projectile.
+	 */
+	virtual class ABSProjectile* SpawnProjectile(const FShotData& ShotData, const bool bPredicted) const;
+
+	/** If a predicted projectile is still in use for a shot and waiting on the server's projectile */
+	static bool IsPredictionPending(const TWeakObjectPtr<class ABSProjectile>& Predicted, const uint16 ShotIndex);
 
 protected:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = ProjectileShot)
 	TSubclassOf<class ABSProjectile> ProjectileType = nullptr;
+
+private:
+	// Projectiles predicted by the owning client that are waiting on the server's projectile,
+	// keyed by shot index.
+	TMap<uint16, TWeakObjectPtr<class ABSProjectile>> PredictedProjectiles;
 };
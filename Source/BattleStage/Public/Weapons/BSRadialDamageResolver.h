@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+class ABSCharacter;
+
+//-----------------------------------------------------------------
+// A detonation waiting to apply radial damage
+//-----------------------------------------------------------------
+struct FBSRadialDamageRequest
+{
+	FRadialDamageParams Params;
+
+	FVector Origin = FVector::ZeroVector;
+
+	TSubclassOf<UDamageType> DamageTypeClass;
+
+	TWeakObjectPtr<AActor> DamageCauser;
+
+	TWeakObjectPtr<AController> Instigator;
+};
+
+/**
+ * Server side resolver for radial damage. Replaces a per explosion overlap query and
+ * visibility traces with a single pass over every detonation queued during a frame.
+ *
+ * Every living character is gathered and bucketed into grid cells at the start of each pass,
+ * so each detonation only tests characters in nearby cells. The buckets are rebuilt every
+ * pass rather than maintained as characters move. Occlusion is tested against static
+ * geometry with one serial trace per unique test, and results are cached for the pass so
+ * chain explosions in the same spot share their traces. Damage is
+ * applied with the same FRadialDamageEvent that UGameplayStatics::ApplyRadialDamageWithFalloff
+ * builds, so falloff and ABSCharacter::SetReceiveHitInfo behave the same.
+ */
+class FBSRadialDamageResolver
+{
+public:
+	/** Queues a detonation to be resolved by the next call to Resolve. */
+	void Queue(const FBSRadialDamageRequest& Request);
+
+	/** Applies damage for every queued detonation. */
+	void Resolve(UWorld* World);
+
+	bool HasPending() const { return Pending.Num() > 0; }
+
+private:
+	/** A character that can be damaged during the current pass */
+	struct FCandidate
+	{
+		ABSCharacter* Character = nullptr;
+
+		/** World center of the character's capsule */
+		FVector Center = FVector::ZeroVector;
+
+		/** Half length of the capsule axis, excluding the hemisphere caps */
+		float AxisHalfLength = 0.f;
+
+		float Radius = 0.f;
+	};
+
+	/** A character within range of a detonation */
+	struct FCandidateHit
+	{
+		int32 RequestIndex = 0;
+
+		int32 CandidateIndex = 0;
+
+		/** Point on the capsule closest to the detonation */
+		FVector ImpactPoint = FVector::ZeroVector;
+
+		/** Index of the occlusion test in OcclusionResults */
+		int32 OcclusionIndex = 0;
+	};
+
+	/** Gathers every living character and buckets it into the grid cells of this pass. */
+	void BucketCandidates(UWorld* World);
+
+	/** Gets the grid cell of a location */
+	FIntVector GetCell(const FVector& Location) const;
+
+	/** Finds or adds an occlusion test between two locations, returning its index in OcclusionResults. */
+	int32 AddOcclusionTest(const FVector& Start, const FVector& End, const int32 CandidateIndex);
+
+private:
+	TArray<FBSRadialDamageRequest> Pending;
+
+	/** Size of a grid cell for the current pass. At least the largest damage radius. */
+	float CellSize = 0.f;
+
+	TArray<FCandidate> Candidates;
+
+	/** Indices of Candidates, by cell */
+	TMap<FIntVector, TArray<int32>> Cells;
+
+	TArray<FCandidateHit> CandidateHits;
+
+	/** Occlusion test index, keyed by quantized detonation origin and candidate */
+	TMap<FIntVector, TMap<int32, int32>> OcclusionCache;
+
+	TArray<FVector> OcclusionStarts;
+
+	TArray<FVector> OcclusionEnds;
+
+	TArray<bool> OcclusionResults;
+};
@@ -5,6 +5,64 @@
 #include "Object.h"
 #include "BSShotType.generated.h"
 
+// Shot spread is replicated in hundredths of a degree
+static const float SHOT_SPREAD_PRECISION = 100.f;
+
+//-------------------------------------------------------------------------------------
+// Compact record of a shot impact sent from clients to the server in place of a full
+// FHitResult. Only contains the data the server reads to process a hit.
+//-------------------------------------------------------------------------------------
+USTRUCT()
+struct FShotHitRecord
+{
+	GENERATED_USTRUCT_BODY()
+
+	// The actor that was hit
+	UPROPERTY()
+	TWeakObjectPtr<AActor> Actor;
+
+	// Index of the bone that was hit on the actor's skeletal mesh. INDEX_NONE if no bone was hit.
+	UPROPERTY()
+	int32 BoneIndex = INDEX_NONE;
+
+	// World location of the impact. Replicated relative to the shot start.
+	UPROPERTY()
+	FVector ImpactPoint = FVector::ZeroVector;
+
+	// Surface type of the physical material that was hit
+	UPROPERTY()
+	TEnumAsByte<EPhysicalSurface> SurfaceType = SurfaceType_Default;
+
+	FShotHitRecord() {}
+
+	/** Builds a hit record from a trace hit result. */
+	explicit FShotHitRecord(const FHitResult& Hit);
+
+	/**
+	* Rebuilds a hit result from the record, for damage events and effects.
+	* 
+	* @param TraceStart	The start of the shot trace.
+	* @param Direction	The direction of the shot trace.
+	*/
+	FHitResult ToHitResult(const FVector& TraceStart, const FVector& Direction) const;
+
+	/**
+	* Bit packs the record. The impact point is quantized relative to an origin, which
+	* must be serialized before the record.
+	* 
+	* @param Origin	The origin ImpactPoint is serialized relative to.
+	*/
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, const FVector& Origin, bool& bOutSuccess);
+
+	/**
+	* Bit packs everything but the hit actor, which needs a package map.
+	*
+	* @param Origin	The origin ImpactPoint is serialized relative to.
+	* @returns False if the impact point was clamped to the quantization range.
+	*/
+	bool SerializeImpact(FArchive& Ar, const FVector& Origin);
+};
+
 //-------------------------------------------------------------------------------------
 // Parameters used to gather and use shot data by UBSShotType when
 // firing a shot and replicating data to the server, when invoked by
@@ -19,18 +77,58 @@ struct FShotData
 	UPROPERTY()
 	FVector_NetQuantize10 Start;
 
-	// The direction of the shot
+	// The aim rotation of the shot before spread is applied
+	UPROPERTY()
+	FRotator AimRotation;
+
+	// Spread, in degrees, used to offset the shot from AimRotation
 	UPROPERTY()
-	FVector_NetQuantizeNormal Direction;
+	float Spread;
 
-	// The hit result of the shot location
+	// Index of the shot fired by the weapon. Keys the weapon's deterministic spread stream.
 	UPROPERTY()
-	FHitResult Impact;
+	uint16 ShotIndex;
+
+	// Index of the shot within its burst. Keys the weapon's recoil pattern.
+	UPROPERTY()
+	uint8 BurstIndex;
+
+	// The direction of the shot, after spread. Not replicated, rebuilt from
+	// AimRotation, Spread and ShotIndex by ABSWeapon::ApplyShotSpread.
+	FVector Direction;
+
+	// Server time the shooter was viewing the world at when the shot was fired. Not replicated,
+	// set by the server from the shot's batch timestamp. 0 if unknown.
+	float RewindTime;
+
+	// The impact of the shot
+	UPROPERTY()
+	FShotHitRecord Impact;
 
 	// If Impact is needed for the shot result
 	UPROPERTY()
 	bool bImpactNeeded;
 
+	FShotData()
+		: AimRotation(ForceInitToZero)
+		, Spread(0.f)
+		, ShotIndex(0)
+		, BurstIndex(0)
+		, Direction(ForceInitToZero)
+		, RewindTime(0.f)
+		, bImpactNeeded(false)
+	{}
+
+	/** Quantizes AimRotation and Spread to the precision they are replicated with. */
+	void Quantize()
+	{
+		AimRotation.Pitch = FRotator::DecompressAxisFromShort(FRotator::CompressAxisToShort(AimRotation.Pitch));
+		AimRotation.Yaw = FRotator::DecompressAxisFromShort(FRotator::CompressAxisToShort(AimRotation.Yaw));
+		AimRotation.Roll = 0.f;
+
+		Spread = FMath::RoundToInt(FMath::Max(0.f, Spread) * SHOT_SPREAD_PRECISION) / SHOT_SPREAD_PRECISION;
+	}
+
 	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
 	{
 		bOutSuccess = true;
@@ -39,14 +137,24 @@ struct FShotData
 
 		Start.NetSerialize(Ar, Map, bOutSuccessLocal);
 		bOutSuccess &= bOutSuccessLocal;
-		Direction.NetSerialize(Ar, Map, bOutSuccessLocal);
-		bOutSuccess &= bOutSuccessLocal;
+
+		AimRotation.SerializeCompressedShort(Ar);
+
+		uint32 PackedSpread = FMath::RoundToInt(FMath::Max(0.f, Spread) * SHOT_SPREAD_PRECISION);
+		Ar.SerializeIntPacked(PackedSpread);
+		Spread = PackedSpread / SHOT_SPREAD_PRECISION;
+
+		Ar << ShotIndex;
+
+		uint32 PackedBurstIndex = BurstIndex;
+		Ar.SerializeIntPacked(PackedBurstIndex);
+		BurstIndex = static_cast<uint8>(PackedBurstIndex);
 
 		Ar.SerializeBits(&bImpactNeeded, 1);
 
 		if (bImpactNeeded) // Don't send the Impact if not needed.
 		{
-			Impact.NetSerialize(Ar, Map, bOutSuccessLocal);
+			Impact.NetSerialize(Ar, Map, Start, bOutSuccessLocal);
 			bOutSuccess &= bOutSuccessLocal;
 		}
 
@@ -63,6 +171,108 @@ struct TStructOpsTypeTraits< FShotData > : public TStructOpsTypeTraitsBase
 	};
 };
 
+// Max number of shots that can be sent to the server in a single batch
+static const int32 MAX_SHOTS_PER_BATCH = 32;
+
+//-------------------------------------------------------------------------------------
+// Shots fired by a client within a single frame, sent to the server in one RPC.
+// Each shot is timestamped with the client's world time when it was fired, sent as
+// a millisecond offset from the first shot in the batch. The batch also carries the
+// timestamp of the owner's character move its last shot was fired during, so the server
+// can order the shots against the weapon input sent with the owner's moves.
+//-------------------------------------------------------------------------------------
+USTRUCT()
+struct FShotBatch
+{
+	GENERATED_USTRUCT_BODY()
+
+	// The shots in the order they were fired
+	UPROPERTY()
+	TArray<FShotData> Shots;
+
+	// Client world time each shot was fired at. Parallel to Shots. After replication,
+	// the time since the first shot in the batch.
+	UPROPERTY()
+	TArray<float> ShotTimes;
+
+	// Client move timestamp of the last shot in the batch
+	UPROPERTY()
+	float MoveTimeStamp = 0.f;
+
+	/** Adds a shot fired at the specified client time. Shots must be added in fire order. */
+	void Add(const FShotData& ShotData, const float ShotTime)
+	{
+		Shots.Add(ShotData);
+		ShotTimes.Add(ShotTime);
+	}
+
+	void Reset()
+	{
+		Shots.Reset();
+		ShotTimes.Reset();
+	}
+
+	int32 Num() const { return Shots.Num(); }
+
+	bool IsFull() const { return Shots.Num() >= MAX_SHOTS_PER_BATCH; }
+
+	/** Gets the time between a shot being fired and the last shot in the batch being fired. */
+	float GetTimeBeforeLast(const int32 Index) const { return ShotTimes.Last() - ShotTimes[Index]; }
+
+	/** Gets the client move timestamp of a shot. */
+	float GetMoveTimeStamp(const int32 Index) const { return MoveTimeStamp - GetTimeBeforeLast(Index); }
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+	{
+		bOutSuccess = true;
+
+		uint32 ShotCount = Shots.Num();
+		Ar.SerializeInt(ShotCount, MAX_SHOTS_PER_BATCH + 1);
+
+		if (Ar.IsLoading())
+		{
+			Shots.SetNum(ShotCount);
+			ShotTimes.SetNum(ShotCount);
+		}
+
+		if (ShotCount == 0)
+		{
+			return true;
+		}
+
+		Ar << MoveTimeStamp;
+
+		const float BaseTime = ShotTimes[0];
+
+		for (uint32 i = 0; i < ShotCount; ++i)
+		{
+			// Shots are in fire order, so offsets from the first shot are never negative
+			uint32 TimeOffsetMs = FMath::RoundToInt(FMath::Max(0.f, ShotTimes[i] - BaseTime) * 1000.f);
+			Ar.SerializeIntPacked(TimeOffsetMs);
+
+			if (Ar.IsLoading())
+			{
+				ShotTimes[i] = TimeOffsetMs * 0.001f;
+			}
+
+			bool bOutSuccessLocal = true;
+			Shots[i].NetSerialize(Ar, Map, bOutSuccessLocal);
+			bOutSuccess &= bOutSuccessLocal;
+		}
+
+		return true;
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits< FShotBatch > : public TStructOpsTypeTraitsBase
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
 /**
  * Base for any type of shot that can be fired from a weapon.
  * Provides an interface for getting the initial shot data from a shot, which
@@ -79,6 +289,8 @@ public:
 	/**
 	* [Client/Server]
 	* Gets shot data associated with a shot being fired from the owning weapon.
+	* The ShotIndex of the shot data is set by the weapon before this is called. AimRotation
+	* is initialized to the weapon's aim at the time of the shot and may be overridden.
 	* 
 	* @param ShotData	Output of the shot data.
 	* 
@@ -121,4 +333,10 @@ protected:
 
 	/** The owning weapon */
 	class ABSWeapon* GetWeapon() const;
+
+	/**
+	* [Server]
+	* Gets the server time characters should be rewound to when resolving a shot.
+	*/
+	float GetRewindTime(const FShotData& ShotData) const;
 };
\ No newline at end of file
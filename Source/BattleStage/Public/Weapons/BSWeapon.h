@@ -6,6 +6,7 @@
 
 #include "BSCharacter.h"
 #include "BSShotType.h"
+#include "BSWeaponAttachment.h"
 
 #include "BSWeapon.generated.h"
 
@@ -87,12 +88,25 @@ struct FWeaponAnim
 	GENERATED_USTRUCT_BODY()
 
 	/** Montage to play on first person mesh */
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
-	UAnimMontage* FirstPerson = nullptr;
+	UPROPERTY(EditDefaultsOnly)
+	TAssetPtr<UAnimMontage> FirstPerson;
 
 	/** Montage to play on third person mesh */
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
-	UAnimMontage* ThirdPerson = nullptr;
+	UPROPERTY(EditDefaultsOnly)
+	TAssetPtr<UAnimMontage> ThirdPerson;
+
+	/** Play length of FirstPerson. Cached in the editor so state transitions never need the montage loaded. */
+	UPROPERTY(VisibleDefaultsOnly)
+	float FirstPersonLength = 0.f;
+
+	/** Play length of ThirdPerson. Cached in the editor so state transitions never need the montage loaded. */
+	UPROPERTY(VisibleDefaultsOnly)
+	float ThirdPersonLength = 0.f;
+
+#if WITH_EDITOR
+	/** Loads both montages and caches their play lengths. */
+	void CacheLengths();
+#endif
 };
 
 UCLASS(Blueprintable, Abstract, NotPlaceable, Config = Game)
@@ -139,6 +153,17 @@ public:
 	UFUNCTION(BlueprintCallable, Category = Weapon)
 	void Reload();
 
+	/**
+	* Server only.
+	* Finishes the Equipping or Reloading transition if the owning client's transition had
+	* finished by the time of a move or shot. The server starts transitions from the move that
+	* carries the client's input, so its timers run behind the client's. The timestamp can't
+	* lead the last move received from the client by more than a small tolerance.
+	*
+	* @param MoveTimeStamp	Client move timestamp of the input or shot.
+	*/
+	void CatchUpTransition(const float MoveTimeStamp);
+
 	/**
 	* Get the character that owns this weapon.
 	*/
@@ -174,14 +199,68 @@ public:
 	UFUNCTION(BlueprintCallable, Category = Weapon)
 	float GetCurrentSpread() const;
 
+	/** Gets the spread of a shot fired at a world time, which may fall between frames. */
+	float GetSpreadAt(const float Time) const;
+
+	/** Gets the spread added by recent shots, recovered by how long ago they were fired. */
+	float GetRecoilSpread() const;
+
+	/** Gets the recoil spread at a world time, which may fall between frames. */
+	float GetRecoilSpreadAt(const float Time) const;
+
+	/**
+	* Gets the view kick of a shot from the weapon's recoil pattern. Patterns are deterministic
+	* per weapon class, so every machine reproduces the same kick from the shot's burst index.
+	*
+	* @param BurstIndex	Index of the shot within its burst.
+	*/
+	FVector2D GetRecoilKick(const uint8 BurstIndex) const;
+
+	/** Gets the view kick of the last shot fired. Usable by animation to kick third person weapons. */
+	UFUNCTION(BlueprintCallable, Category = Weapon)
+	FVector2D GetLastRecoilKick() const { return LastRecoilKick; }
+
+	/**
+	* Gets the deterministic random stream for a shot fired by this weapon. The owning
+	* client and the server generate identical streams for the same shot index.
+	*
+	* @param ShotIndex	The index of the shot.
+	*/
+	FRandomStream GetShotRandomStream(const uint16 ShotIndex) const;
+
+	/**
+	* Quantizes the aim rotation and spread of shot data and sets its Direction to a
+	* spread cone direction generated from the shot's random stream.
+	*
+	* @param ShotData	The shot data to apply spread to.
+	*/
+	void ApplyShotSpread(FShotData& ShotData) const;
+
+	/**
+	* Client only.
+	* Starts streaming in the weapon's sounds, effects and animations. Called for each weapon in
+	* a character's loadout so the assets are loaded before the weapon is first equipped. Effects
+	* that haven't finished loading are skipped.
+	*/
+	void PreloadCosmeticAssets();
+
 	/** AActor interface */
 	virtual void BeginDestroy() override;
-	virtual void PostInitProperties() override;
 	virtual bool ReplicateSubobjects(class UActorChannel *Channel, class FOutBunch *Bunch, FReplicationFlags *RepFlags) override;
 	virtual void PostInitializeComponents() override;
 	virtual void SetOwner(AActor* NewOwner) override;	
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
 	/** AActor interface end */
 
+	/** UObject interface */
+#if WITH_EDITOR
+	virtual void PostLoad() override;
+	virtual void PreSave() override;
+#endif
+	/** UObject interface end */
+
 protected:
 	//-----------------------------------------------------------------
 	// Weapon Events
@@ -194,8 +273,25 @@ protected:
 	*
 	* Gives the opportunity to activate visual effects or weapon stat effects
 	* that should be applied following a shot.
+	*
+	* @param BurstIndex	Index of the shot within its burst.
+	* @param ShotTime	World time the shot was fired at. Shots fired locally can be scheduled
+	*					between frames, remotes use the time the shot was replicated.
 	*/
-	virtual void OnShotFired();
+	virtual void OnShotFired(const uint8 BurstIndex, const float ShotTime);
+
+	/** Adds the recoil spread of a shot fired at a world time. */
+	void AddRecoilSpread(const float ShotTime);
+
+	/**
+	* Server only. Gets the world time a client's shot was fired at for recoil. Shots are spaced by
+	* the client's time between them, no closer than the fire interval and no later than the shot
+	* arrived, so network jitter within a batch doesn't read as faster fire.
+	*
+	* @param MoveTimeStamp		Client move timestamp the shot was fired at.
+	* @param ArrivalShotTime	World time the shot was fired at, estimated from when it arrived.
+	*/
+	float GetServerShotTime(const float MoveTimeStamp, const float ArrivalShotTime) const;
 
 	/**
 	* Called when the weapon state has been transition into the Firing state.
@@ -233,10 +329,49 @@ protected:
 	virtual void OnEnteredInactiveState();	
 
 protected:
-	// Owning client only.
-	void FireShot();
+	/**
+	* Owning client only. Fires any shots that are due this frame. Shots are fired at
+	* exact FireRate intervals, so several shots may be fired in a single frame. Each is
+	* timestamped at the time it was due and aimed between the previous and current aim.
+	*
+	* @param DeltaTime	Length of the frame.
+	*/
+	void UpdateFireSchedule(const float DeltaTime);
+
+	/**
+	* Enables tick only while the fire schedule is active or the view is recovering from
+	* recoil. Recoil spread is computed from the last shot time, so it never needs a tick.
+	*/
+	void UpdateTickEnabled();
+
+	/**
+	* Server only.
+	* Puts the weapon to sleep for replication while it is Inactive, and wakes it for any other state.
+	* Owner relevancy keeps idle weapons relevant, so dormancy is what stops them replicating.
+	*/
+	void UpdateNetDormancy();
+
+	/**
+	* Owning client only. Fires a single shot.
+	*
+	* @param ShotTime		World time the shot is fired at.
+	* @param AimRotation	Aim rotation at the time of the shot.
+	*/
+	void FireShot(const float ShotTime, const FRotator& AimRotation);
 
-	void InvokeShot(const FShotData& ShotData);
+	void InvokeShot(const FShotData& ShotData, const float ShotTime);
+
+	/**
+	* Owning client only. Queues a shot to be sent to the server in the next shot batch.
+	* The batch is sent on the next tick, or sooner if it fills up or the weapon state changes.
+	*
+	* @param ShotData	The shot to send.
+	* @param ShotTime	World time the shot was fired at.
+	*/
+	void QueueShot(const FShotData& ShotData, const float ShotTime);
+
+	/** Owning client only. Sends any queued shots to the server. */
+	void FlushShots();
 
 	/**
 	* Starts the equip sequence. Activates effects that should be played on clients, 
@@ -292,9 +427,6 @@ protected:
 	UFUNCTION(BlueprintCallable, Category = Weapon)
 	virtual void SetWeaponState(EWeaponState State);
 
-	UFUNCTION(Server, Reliable, WithValidation)
-	virtual void ServerSetWeaponState(const EWeaponState State);
-
 	/**
 	 * Controlling Client Only.
 	 * Handles a new weapon state on the controlling client.
@@ -347,13 +479,19 @@ protected:
 	*/
 	virtual void OnUnequipTransitionExit();
 
+	/** Server only. Finishes the Equipping or Reloading transition now. */
+	void FinishTransition();
+
+	/** Server only. Gets the timestamp of the last move received from the owning client. */
+	float GetServerMoveTimeStamp() const;
+
 private:
 	/**
-	* Only called on the server. Notifies the weapon that a shot has been fired
-	* and to activate any unnecessary events.
+	* Only called on the server. Notifies the weapon that a batch of shots has been fired
+	* and to activate any unnecessary events. Shots are invoked in the order they were fired.
 	*/
 	UFUNCTION(Server, Reliable, WithValidation)
-	void ServerInvokeShot(const FShotData& ShotData);
+	void ServerInvokeShots(const FShotBatch& ShotBatch);
 
 protected:
 	// The character that has this weapon equipped. 
@@ -364,7 +502,7 @@ protected:
 	UPROPERTY(VisibleDefaultsOnly, BlueprintReadOnly, Category = Defaults)
 	class USkeletalMeshComponent* MeshTP;
 
-	// First person mesh for the weapon
+	// First person mesh for the weapon. Null on dedicated servers.
 	UPROPERTY(VisibleDefaultsOnly, BlueprintReadOnly, Category = Defaults)
 	class USkeletalMeshComponent* MeshFP;
 
@@ -388,7 +526,26 @@ public:
 	UFUNCTION(BlueprintCallable, Category = Weapon)
 	int32 GetRemainingClip() const { return RemainingClip; }
 
-	const FWeaponStats& GetWeaponStats() const { return WeaponStats; }
+	/** Gets the weapon's stats with every attachment applied */
+	const FWeaponStats& GetWeaponStats() const { return CompiledStats; }
+
+	/**
+	* Server only.
+	* Fits an attachment, replacing any attachment in the same slot.
+	*/
+	UFUNCTION(BlueprintCallable, Category = Weapon)
+	void SetAttachment(UBSWeaponAttachment* Attachment);
+
+	/**
+	* Server only.
+	* Removes the attachment in a slot, if there is one.
+	*/
+	UFUNCTION(BlueprintCallable, Category = Weapon)
+	void RemoveAttachment(EWeaponAttachmentSlot Slot);
+
+	const TArray<UBSWeaponAttachment*>& GetAttachments() const { return Attachments; }
+
+	class UBSShotType* GetShotType() const { return ShotType; }
 
 protected:
 	// The previous weapon state. This is to be used with OnRep_WeaponState
@@ -397,10 +554,24 @@ protected:
 	UPROPERTY(BlueprintReadOnly, Category = WeaponData)
 	EWeaponState PrevWeaponState = EWeaponState::Inactive;
 
-	// Common weapon firing data
+	// Common weapon firing data, before attachments are applied
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = WeaponData)
 	FWeaponStats WeaponStats;
 
+	// Attachments fitted to the weapon, at most one per slot
+	UPROPERTY(EditDefaultsOnly, ReplicatedUsing = OnRep_Attachments, Category = WeaponData)
+	TArray<UBSWeaponAttachment*> Attachments;
+
+	// WeaponStats with every attachment applied. Read by everything that uses the weapon's stats.
+	UPROPERTY(Transient, BlueprintReadOnly, Category = WeaponData)
+	FWeaponStats CompiledStats;
+
+	/** Rebuilds CompiledStats and RecoilPattern from WeaponStats and Attachments. Called only when attachments change. */
+	void CompileStats();
+
+	/** View kick of each shot in a burst, baked from CompiledStats. Bursts longer than the pattern repeat it. */
+	TArray<FVector2D> RecoilPattern;
+
 	// The projectile class fired by this weapon
 	UPROPERTY(EditDefaultsOnly, Category = WeaponData)
 	TSubclassOf<class UBSShotType> ShotTypeClass = nullptr;
@@ -412,25 +583,69 @@ protected:
 	// and invoke actions. Should not be used on clients.
 	FTimerHandle WeaponStateTimer;
 
-	// Timer used to to fire shots while in the Firing state for
-	// automatic weapons and the FireRate.
-	FTimerHandle WeaponFiringTimer;
+	// Server only. Client move timestamp when the current Equipping or Reloading transition started.
+	float TransitionTimeStamp = 0.f;
 
 	// Game time when the last shot was fired.
 	float LastFireTime = 0.f;
 
-	// Accumulator for recoil spread applied per shot
-	float CurrentRecoilSpread = 0.f;
+	// Game time the next shot is due while the fire schedule is active
+	float NextFireTime = 0.f;
+
+	// If shots are being scheduled by UpdateFireSchedule. Cleared when leaving the
+	// Firing state, or after the first shot of a semi-automatic weapon.
+	bool bFireScheduleActive = false;
+
+	// Aim rotation at the end of the previous frame. Used to interpolate the aim of
+	// shots fired between frames.
+	FRotator PrevAimRotation = FRotator::ZeroRotator;
+
+	// Index of the next shot fired by the owning client
+	uint16 NextShotIndex = 0;
+
+	// Index of the last shot received by the server. Shots must arrive in order without gaps.
+	uint16 LastServerShotIndex = MAX_uint16;
+
+	// Server only. Recoil world time and client move timestamp of the last shot received.
+	float LastServerShotTime = 0.f;
+	float LastServerShotTimeStamp = 0.f;
+
+	// Server only. If LastServerShotTime has been set by a received shot.
+	bool bHasServerShotTime = false;
+
+	// Shots fired by the owning client that have not been sent to the server yet
+	FShotBatch PendingShots;
+
+	// Recoil spread right after the last shot. Recovers over time from LastRecoilTime.
+	float RecoilSpreadAtLastShot = 0.f;
+
+	// World time recoil spread was last added
+	float LastRecoilTime = 0.f;
 
 	// Accumulator for recoil push offset applied per shot
 	FVector2D CurrentRecoilOffset = FVector2D::ZeroVector;
 
+	// Burst index of the next shot fired by the owning client. Reset when the weapon starts firing.
+	uint8 NextBurstIndex = 0;
+
+	// View kick of the last shot fired
+	FVector2D LastRecoilKick = FVector2D::ZeroVector;
+
+	// Seed of the random stream used to generate shot spread. Shared by the owning
+	// client and the server so only a shot index is needed to rebuild a shot.
+	UPROPERTY(Replicated)
+	int32 SpreadSeed = 0;
+
 private:
 	// Toggle flag that indicates that the server fired a shot when changed.
 	// Should not be interpreted as true/false.
 	UPROPERTY(ReplicatedUsing = OnRep_ServerFired)
 	uint32 bServerFired : 1;
 
+	// Burst index of the last shot invoked on the server, so other clients reproduce its recoil
+	UPROPERTY(Replicated)
+	uint8 ServerBurstIndex = 0;
+
 private:
 	// Current state of the weapon
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, ReplicatedUsing = OnRep_WeaponState, Category = WeaponData, meta = (AllowPrivateAccess = "true"))
@@ -457,22 +672,34 @@ protected:
 	// firing weapon state if it is a looping sound. Otherwise, it will be played
 	// at the time of each shot. For automatic weapons, it is recommended to use
 	// looping firing sounds.
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Sound)
-	USoundBase* FireSound = nullptr;
+	UPROPERTY(EditDefaultsOnly, Category = Sound)
+	TAssetPtr<USoundBase> FireSound;
 
 	// Sound effect on weapon end fire
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Sound)
-	USoundBase* EndFireSound = nullptr;
+	UPROPERTY(EditDefaultsOnly, Category = Sound)
+	TAssetPtr<USoundBase> EndFireSound;
 
 	// Sound effect on weapon fire with empty clip
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Sound)
-	USoundBase* EmptyClipSound = nullptr;
+	UPROPERTY(EditDefaultsOnly, Category = Sound)
+	TAssetPtr<USoundBase> EmptyClipSound;
 
 	//-----------------------------------------------------------------
 	// Weapon Animation 
 	//-----------------------------------------------------------------
 protected:
-	UAnimMontage* GetWeaponMontage(const FWeaponAnim& WeaponAnim);
+	/** Gets the montage for the active mesh, or null if it isn't loaded. */
+	UAnimMontage* GetWeaponMontage(const FWeaponAnim& WeaponAnim) const;
+
+	/**
+	* Gets the cached play length used to time a state transition. The owning client and the server
+	* use the same length, the one of the montage the owner plays.
+	*/
+	float GetTransitionLength(const FWeaponAnim& WeaponAnim) const;
+
+#if WITH_EDITOR
+	/** Caches the montage lengths of every weapon animation. */
+	void CacheAnimLengths();
+#endif
 
 protected:
 	// Played on the character on equip
@@ -488,8 +715,8 @@ protected:
 	FWeaponAnim FireAnim;
 
 	// Camera shake on weapon fire
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Animation)
-	TSubclassOf<class UCameraShake> FireCameraShake;
+	UPROPERTY(EditDefaultsOnly, Category = Animation)
+	TAssetSubclassOf<class UCameraShake> FireCameraShake;
 
 	// Played on the character on reload
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Animation)
@@ -500,14 +727,23 @@ protected:
 	//-----------------------------------------------------------------
 protected:
 	// Muzzle FX for firing
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = FX)
-	class UParticleSystem* MuzzleFX = nullptr;
+	UPROPERTY(EditDefaultsOnly, Category = FX)
+	TAssetPtr<class UParticleSystem> MuzzleFX;
 
 	// Spawned particle system component for muzzle FX
 	UPROPERTY(Transient)
 	class UParticleSystemComponent* MuzzleFXComponent = nullptr;
 
 private:
+	/** Called when the cosmetic assets requested by PreloadCosmeticAssets have loaded. */
+	void OnCosmeticAssetsLoaded();
+
+	/** Cosmetic assets that have been streamed in, referenced so they stay loaded while the weapon exists */
+	UPROPERTY(Transient)
+	TArray<UObject*> LoadedCosmeticAssets;
+
+	/** If the cosmetic assets have been requested */
+	bool bCosmeticAssetsRequested = false;
 
 	//-----------------------------------------------------------------
 	// On Replicated
@@ -516,6 +752,9 @@ private:
 	UFUNCTION()
 	void OnRep_ServerFired();
 
+	UFUNCTION()
+	void OnRep_Attachments();
+
 	/** Invokes state transition events on clients */
 	UFUNCTION()
 	void OnRep_WeaponState();
@@ -524,6 +763,6 @@ private:
 	virtual void OnRep_Owner() override;
 };
 
-FORCEINLINE USkeletalMeshComponent* ABSWeapon::GetActiveMesh() const { return BSCharacter->IsFirstPerson() ? MeshFP : MeshTP; }
+FORCEINLINE USkeletalMeshComponent* ABSWeapon::GetActiveMesh() const { return (MeshFP && BSCharacter && BSCharacter->IsFirstPerson()) ? MeshFP : MeshTP; }
 
 FORCEINLINE ABSCharacter* ABSWeapon::GetCharacter() const { return BSCharacter; }
\ No newline at end of file
@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Engine/DataAsset.h"
+#include "BSWeaponAttachment.generated.h"
+
+UENUM()
+enum class EWeaponAttachmentSlot : uint8
+{
+	Optic,
+	Barrel,
+	Magazine,
+	Stock,
+	Max	UMETA(Hidden)
+};
+
+// Weapon stats that attachments can modify. Each is a field of FWeaponStats.
+UENUM()
+enum class EWeaponStat : uint8
+{
+	MaxAmmo,
+	ClipSize,
+	BaseDamage,
+	FireRate,
+	ReloadSpeed,
+	Stability,
+	BaseSpread,
+	StandingSpreadIncrement,
+	MovingSpreadIncrement,
+	RecoilSpreadIncrement,
+	RecoilPushSpread,
+	Max	UMETA(Hidden)
+};
+
+USTRUCT()
+struct FWeaponStatModifier
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(EditDefaultsOnly, Category = Modifier)
+	EWeaponStat Stat = EWeaponStat::BaseDamage;
+
+	// Added to the weapon's base stat
+	UPROPERTY(EditDefaultsOnly, Category = Modifier)
+	float Add = 0.f;
+
+	// Scales the stat after every attachment's Add has been applied
+	UPROPERTY(EditDefaultsOnly, Category = Modifier)
+	float Multiply = 1.f;
+};
+
+//-----------------------------------------------------------------
+// Every attachment's modifiers summed per stat, ready to be
+// applied to a weapon's base stats.
+//-----------------------------------------------------------------
+struct FWeaponStatModifierTotals
+{
+	float Add[(int32)EWeaponStat::Max];
+
+	float Multiply[(int32)EWeaponStat::Max];
+
+	FWeaponStatModifierTotals();
+
+	/** Adds the modifiers of an attachment to the totals. */
+	void Accumulate(const class UBSWeaponAttachment& Attachment);
+
+	/** Applies the totals of a stat to its base value. */
+	float Apply(const EWeaponStat Stat, const float BaseValue) const
+	{
+		return (BaseValue + Add[(int32)Stat]) * Multiply[(int32)Stat];
+	}
+};
+
+/**
+ * A weapon attachment, such as a scope, barrel or magazine. Attachments only modify weapon stats.
+ * A weapon compiles its attachments into a single flattened stat block when its attachments
+ * change, so firing never evaluates modifiers.
+ */
+UCLASS(BlueprintType)
+class BATTLESTAGE_API UBSWeaponAttachment : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/** Slot the attachment occupies. A weapon holds one attachment per slot. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Attachment)
+	EWeaponAttachmentSlot Slot = EWeaponAttachmentSlot::Optic;
+
+	UPROPERTY(EditDefaultsOnly, Category = Attachment)
+	TArray<FWeaponStatModifier> Modifiers;
+};
@@ -19,6 +19,7 @@ public class BattleStage : ModuleRules
                 "BattleStage/Private/Player",
                 "BattleStage/Private/Weapons",
                 "BattleStage/Private/Sound",
+                "BattleStage/Private/Tests",
             });
 
         PublicDependencyModuleNames.AddRange(